@@ -0,0 +1,140 @@
+/*
+    Accuracy and throughput of inverse mapping output coordinates in float against double.
+
+    The transform is composed and inverted in double, like the warper does, and the inverse is then
+    applied to the output pixel coordinates of a size x size image once as a Matrix3x3 to double
+    points and once as a Matrix3x3f to float points. The error is the largest distance in pixels
+    between the two source coordinates, over the pixels that map into the source. Exits with status
+    1 if it is larger than 1/64 pixel at any size up to 16384, where a float still resolves
+    coordinates to 1/512 pixel.
+
+    usage: precisionbench [largest size]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../vecmat/Matrix.h"
+
+using namespace std;
+
+#define ERROR_BOUND (1.0 / 64.0)
+#define BOUNDED_SIZE 16384
+#define SAMPLED_ROWS 256
+
+
+/*
+    Forward transforms of a size x size image, the perspective one tilts it by the same angle at any size
+ */
+Matrix3x3 makeTransform(int kind, int size) {
+    double radians = 30.0 * M_PI / 180.0;
+    Matrix3x3 rotation(cos(radians), -sin(radians), 0.0, sin(radians), cos(radians), 0.0, 0.0, 0.0, 1.0);
+    Matrix3x3 shear(1.0, 0.3, 0.0, 0.1, 1.0, 0.0, 0.0, 0.0, 1.0);
+    Matrix3x3 scale(1.7, 0.0, 0.0, 0.0, 0.6, 0.0, 0.0, 0.0, 1.0);
+    Matrix3x3 perspective(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.4 / size, 0.2 / size, 1.0);
+    switch (kind) {
+        case 0:
+            return rotation;
+        case 1:
+            return rotation * shear * scale;
+        default:
+            return perspective * rotation;
+    }
+}
+
+
+const char *transformName(int kind) {
+    return kind == 0 ? "rotation" : kind == 1 ? "affine" : "perspective";
+}
+
+
+/*
+    Best of a few runs of f, in million points per second
+ */
+template <typename F>
+double measure(F f, size_t points) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return points / best / 1e6;
+}
+
+
+/*
+    Largest error in pixels of the float mapping, and the throughput of both mappings
+ */
+bool compare(int kind, int size) {
+    Matrix3x3 forward = makeTransform(kind, size);
+
+    // output image placed on the min corner of the forward mapped source, as in the warper
+    const double corners_x[4] = {0.0, 0.0, (double) size, (double) size};
+    const double corners_y[4] = {0.0, (double) size, 0.0, (double) size};
+    double mapped_x[4], mapped_y[4];
+    forward.transformPoints(corners_x, corners_y, mapped_x, mapped_y, 4, true);
+    double min_x = HUGE_VAL, max_x = -HUGE_VAL, min_y = HUGE_VAL, max_y = -HUGE_VAL;
+    for (int i = 0; i < 4; i++) {
+        min_x = min(min_x, mapped_x[i]);
+        max_x = max(max_x, mapped_x[i]);
+        min_y = min(min_y, mapped_y[i]);
+        max_y = max(max_y, mapped_y[i]);
+    }
+    int width = (int) ceil(max_x - min_x);
+
+    // every column of evenly spaced rows
+    size_t points = (size_t) width * SAMPLED_ROWS;
+    vector<double> xs(points), ys(points), us(points), vs(points);
+    vector<float> xs_float(points), ys_float(points), us_float(points), vs_float(points);
+    for (int row = 0; row < SAMPLED_ROWS; row++)
+        for (int col = 0; col < width; col++) {
+            size_t i = (size_t) row * width + col;
+            xs[i] = xs_float[i] = (float) (floor(min_x) + col);
+            ys[i] = ys_float[i] = (float) (floor(min_y) + floor((max_y - min_y) * row / (SAMPLED_ROWS - 1)));
+        }
+
+    Matrix3x3 inverse = forward.inv();
+    Matrix3x3f inverse_float(inverse);
+    bool projective = kind == 2;
+    double rate = measure([&]() { inverse.transformPoints(xs.data(), ys.data(), us.data(), vs.data(), points,
+                                                         projective); }, points);
+    double rate_float = measure([&]() { inverse_float.transformPoints(xs_float.data(), ys_float.data(),
+                                                                     us_float.data(), vs_float.data(), points,
+                                                                     projective); }, points);
+
+    double max_error = 0.0, sum_error = 0.0;
+    size_t inside = 0;
+    for (size_t i = 0; i < points; i++) {
+        if (us[i] < -0.5 or us[i] > size - 0.5 or vs[i] < -0.5 or vs[i] > size - 0.5)
+            continue;
+        double error = max(fabs(us_float[i] - us[i]), fabs(vs_float[i] - vs[i]));
+        max_error = max(max_error, error);
+        sum_error += error;
+        inside++;
+    }
+
+    bool bounded = size > BOUNDED_SIZE or max_error <= ERROR_BOUND;
+    printf("%8d %-12s %12.6f %12.6f %10.1f %10.1f%s\n", size, transformName(kind), max_error,
+           inside ? sum_error / inside : 0.0, rate, rate_float, bounded ? "" : "  over bound");
+    return bounded;
+}
+
+
+int main(int argc, char **argv) {
+    int largest = argc > 1 ? atoi(argv[1]) : 65536;
+    if (largest <= 0) {
+        fprintf(stderr, "usage: %s [largest size]\n", argv[0]);
+        return 1;
+    }
+
+    printf("float against double source coordinates, error in pixels, throughput in million points per second\n");
+    printf("%8s %-12s %12s %12s %10s %10s\n", "size", "transform", "max error", "mean error", "double", "float");
+    bool bounded = true;
+    for (int size = 1024; size <= largest; size *= 4)
+        for (int kind = 0; kind < 3; kind++)
+            bounded = compare(kind, size) and bounded;
+    return bounded ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/*
+    Throughput of the warp kernels against the rotation angle, for an interleaved and a tiled source.
+
+    Rotating by 0 degrees reads the source along its rows. Past a few degrees, consecutive output
+    pixels step down source rows, and an interleaved source costs a cache line (and a TLB entry on
+    wide images) per pixel; a tiled one stays inside the same 16x16 block for 16 of them.
+
+    usage: rotationbench [size] [uint8|uint16|half|float] [filter] [threads]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../warp/kernels.h"
+#include "synthetic.h"
+
+using namespace std;
+
+/*
+    Rotation about the origin, with the output sized and placed on the bounds of the rotated corners
+ */
+WarpJob makeJob(const ImageView &source, double degrees, WarpFilter filter, int &width, int &height) {
+    double radians = degrees * M_PI / 180.0;
+    Matrix3x3 rotation(cos(radians), -sin(radians), 0.0,
+                       sin(radians), cos(radians), 0.0,
+                       0.0, 0.0, 1.0);
+
+    double min_x = 0.0, max_x = 0.0, min_y = 0.0, max_y = 0.0;
+    const double corners[4][2] = {{0.0, 0.0}, {(double) source.width, 0.0}, {0.0, (double) source.height},
+                                  {(double) source.width, (double) source.height}};
+    for (int i = 0; i < 4; i++) {
+        Vector3d corner = rotation * Vector3d(corners[i][0], corners[i][1], 1.0);
+        min_x = min(min_x, corner[0]);
+        max_x = max(max_x, corner[0]);
+        min_y = min(min_y, corner[1]);
+        max_y = max(max_y, corner[1]);
+    }
+    width = (int) ceil(max_x - min_x);
+    height = (int) ceil(max_y - min_y);
+
+    WarpJob job;
+    job.source = source;
+    job.inverse_matrix = rotation.inv();
+    job.origin = Vector3d(floor(min_x), floor(min_y), 0.0);
+    job.isa = detectSimdIsa();
+    job.filter = filter;
+    job.edge = EDGE_BLACK;
+    job.filter_table = buildFilterTable(filter);
+    job.minify = MINIFY_NONE;
+    job.mipmap = NULL;
+    return job;
+}
+
+
+/*
+    Best of a few runs, in output megapixels per second
+ */
+double measure(WarpJob job, int width, int height, ThreadPool &pool) {
+    Image destination(width, height, LAYOUT_INTERLEAVED, job.source.format);
+    job.destination = destination.view();
+    WarpKernelFunction kernel = getWarpKernelFunction(selectWarpKernel(job, WARP_KERNEL_AUTO));
+
+    warpTiled(job, kernel, pool);  // page the destination in
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        warpTiled(job, kernel, pool);
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return (double) width * height / best / 1e6;
+}
+
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 4096;
+    PixelFormat format = FORMAT_UINT8;
+    WarpFilter filter = FILTER_NEAREST;
+    if ((argc > 2 and !parsePixelFormat(argv[2], format)) or (argc > 3 and !parseWarpFilter(argv[3], filter)) or
+        size <= 0) {
+        fprintf(stderr, "usage: %s [size] [uint8|uint16|half|float] [filter] [threads]\n", argv[0]);
+        return 1;
+    }
+    ThreadPool pool(argc > 4 ? atoi(argv[4]) : 1);
+
+    Image interleaved = makeSyntheticImage(size, size, format);
+    Image tiled = interleaved.converted(LAYOUT_TILED);
+
+    printf("%dx%d %s source, %s filter, %s, %d threads, output MP/s\n", size, size, pixelFormatName(format),
+           warpFilterName(filter), simdIsaName(detectSimdIsa()), pool.threadCount());
+    printf("%8s %12s %12s %8s\n", "degrees", "interleaved", "tiled", "ratio");
+    const double angles[] = {0.0, 1.0, 5.0, 15.0, 30.0, 45.0, 60.0, 75.0, 89.0, 90.0, 135.0, 180.0};
+    for (size_t i = 0; i < sizeof(angles) / sizeof(angles[0]); i++) {
+        int width, height;
+        WarpJob job = makeJob(interleaved.view(), angles[i], filter, width, height);
+        double interleaved_rate = measure(job, width, height, pool);
+        job.source = tiled.view();
+        double tiled_rate = measure(job, width, height, pool);
+        printf("%8.0f %12.1f %12.1f %8.2f\n", angles[i], interleaved_rate, tiled_rate, tiled_rate / interleaved_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef _H_Synthetic
+#define _H_Synthetic
+
+#include "../warp/image.h"
+
+/*
+    Synthetic source of the benchmarks: smooth gradients with some high frequency detail, fully
+    opaque. Stored straight in the sample type, so even a 16K x 16K source needs no float copy.
+ */
+template <ImageLayout layout, typename T>
+inline void fillSynthetic(const ImageView &image) {
+    for (int row = 0; row < image.height; row++)
+        for (int col = 0; col < image.width; col++) {
+            pixel p;
+            p.r = col / (float) image.width;
+            p.g = row / (float) image.height;
+            p.b = ((col ^ row) & 15) / 15.0f;
+            p.a = 1.0f;
+            Pixels<layout, T>::store(image, col, row, p);
+        }
+}
+
+
+inline Image makeSyntheticImage(int width, int height, PixelFormat format) {
+    Image image(width, height, LAYOUT_INTERLEAVED, format);
+    ImageView view = image.view();
+    DISPATCH_STORAGE(view, fillSynthetic, view);
+    return image;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+    Cost of vecmat arithmetic evaluated as one expression against evaluating it an operator at a time.
+
+    Sums, differences, scalar multiples and products of the dynamic Vector and Matrix are expressions that
+    are evaluated in a single loop when assigned. The "per operator" column evaluates the same arithmetic
+    with the operators vecmat had before, kept in vecmat_eager.h, which return a new object per operator
+    and allocate every row of a Matrix on its own.
+
+    usage: vecmatbench [iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../vecmat/Matrix.h"
+#include "vecmat_eager.h"
+
+using namespace std;
+
+
+static volatile double sink = 0.0;  // keeps the results alive
+
+
+/*
+    Best of a few runs of iterations calls, in nanoseconds per call
+ */
+template <typename F>
+double measure(F f, int iterations) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            f(i);
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best / iterations * 1e9;
+}
+
+
+template <typename V>
+V makeVector(int n, double seed) {
+    V v(n);
+    for (int i = 0; i < n; i++)
+        v[i] = seed + 0.25 * i;
+    return v;
+}
+
+
+template <typename M>
+M makeMatrix(int n, double seed) {
+    M m(n, n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            m[i][j] = seed + (i == j ? 2.0 : 0.125 * (i - j));
+    return m;
+}
+
+
+void report(const char *name, double fused, double eager) {
+    printf("%-28s %12.1f %14.1f %8.2f\n", name, fused, eager, eager / fused);
+}
+
+
+void vectorSum(int n, int iterations) {
+    Vector a = makeVector<Vector>(n, 1.0), b = makeVector<Vector>(n, 2.0), c = makeVector<Vector>(n, 3.0), r;
+    double fused = measure([&](int i) {
+        a[0] = i;
+        r = a + b * 2.0 - c;
+        sink = sink + r[n - 1];
+    }, iterations);
+
+    eager::Vector ea = makeVector<eager::Vector>(n, 1.0), eb = makeVector<eager::Vector>(n, 2.0),
+                  ec = makeVector<eager::Vector>(n, 3.0), er;
+    double eager = measure([&](int i) {
+        ea[0] = i;
+        er = ea + eb * 2.0 - ec;
+        sink = sink + er[n - 1];
+    }, iterations);
+
+    char name[64];
+    snprintf(name, sizeof(name), "a + b * 2 - c, n = %d", n);
+    report(name, fused, eager);
+}
+
+
+void matrixSum(int n, int iterations) {
+    Matrix a = makeMatrix<Matrix>(n, 1.0), b = makeMatrix<Matrix>(n, 2.0), c = makeMatrix<Matrix>(n, 3.0), r;
+    double fused = measure([&](int i) {
+        a[0][0] = i;
+        r = a * b + c * 0.5;
+        sink = sink + r[n - 1][n - 1];
+    }, iterations);
+
+    eager::Matrix ea = makeMatrix<eager::Matrix>(n, 1.0), eb = makeMatrix<eager::Matrix>(n, 2.0),
+                  ec = makeMatrix<eager::Matrix>(n, 3.0), er;
+    double eager = measure([&](int i) {
+        ea[0][0] = i;
+        er = ea * eb + ec * 0.5;
+        sink = sink + er[n - 1][n - 1];
+    }, iterations);
+
+    char name[64];
+    snprintf(name, sizeof(name), "A * B + C * 0.5, %d x %d", n, n);
+    report(name, fused, eager);
+}
+
+
+void matrixVector(int n, int iterations) {
+    Matrix m = makeMatrix<Matrix>(n, 0.5);
+    Vector p = makeVector<Vector>(n, 1.0), origin = makeVector<Vector>(n, -4.0), r;
+    double fused = measure([&](int i) {
+        p[0] = i;
+        r = m * (p + origin);
+        sink = sink + r[n - 1];
+    }, iterations);
+
+    eager::Matrix em = makeMatrix<eager::Matrix>(n, 0.5);
+    eager::Vector ep = makeVector<eager::Vector>(n, 1.0), eorigin = makeVector<eager::Vector>(n, -4.0), er;
+    double eager = measure([&](int i) {
+        ep[0] = i;
+        er = em * (ep + eorigin);
+        sink = sink + er[n - 1];
+    }, iterations);
+
+    char name[64];
+    snprintf(name, sizeof(name), "M * (p + origin), n = %d", n);
+    report(name, fused, eager);
+}
+
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-28s %12s %14s %8s\n", "ns per evaluation", "expression", "per operator", "ratio");
+    vectorSum(3, iterations);
+    vectorSum(64, iterations / 10);
+    matrixVector(3, iterations);
+    matrixVector(64, iterations / 100);
+    matrixSum(3, iterations);
+    matrixSum(16, iterations / 100);
+    return 0;
+}
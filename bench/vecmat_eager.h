@@ -0,0 +1,141 @@
+/*
+    The dynamic Vector and Matrix as they were before the expression templates and the single block
+    storage, kept for vecmatbench to time against: every operator returns a new object by copy, a
+    Vector allocates its elements and a Matrix an array of row Vectors, each allocating its own row.
+    Only the operators the benchmark uses are kept, without the size checks.
+ */
+
+#ifndef _H_VecmatEager
+#define _H_VecmatEager
+
+#include <cstddef>
+
+namespace eager {
+
+class Vector {
+protected:
+  int N;
+  double *v;
+
+public:
+  Vector(int vN = 0) : N(0), v(NULL) { setsize(vN); }
+  Vector(const Vector& V) : N(0), v(NULL) { setsize(V.N); *this = V; }
+  ~Vector() { delete []v; }
+
+  void setsize(int vN){
+    N = vN;
+    v = N == 0 ? NULL : new double[N];
+    for(int i = 0; i < N; i++)
+      v[i] = 0;
+  }
+
+  int getn() const { return N; }
+  double& operator[](int i) { return v[i]; }
+  const double& operator[](int i) const { return v[i]; }
+
+  const Vector& operator=(const Vector& v2){
+    if(N != v2.N){
+      delete []v;
+      setsize(v2.N);
+    }
+    for(int i = 0; i < N; i++)
+      v[i] = v2.v[i];
+    return *this;
+  }
+
+  friend Vector operator+(const Vector& v1, const Vector& v2){
+    Vector r(v1.N);
+    for(int i = 0; i < v1.N; i++)
+      r[i] = v1.v[i] + v2.v[i];
+    return r;
+  }
+
+  friend Vector operator-(const Vector& v1, const Vector& v2){
+    Vector r(v1.N);
+    for(int i = 0; i < v1.N; i++)
+      r[i] = v1.v[i] - v2.v[i];
+    return r;
+  }
+
+  friend Vector operator*(const Vector& v1, double s){
+    Vector r(v1.N);
+    for(int i = 0; i < v1.N; i++)
+      r[i] = s * v1.v[i];
+    return r;
+  }
+};
+
+class Matrix {
+protected:
+  Vector *row;
+  int Nrows, Ncols;
+
+public:
+  Matrix(int rows = 0, int cols = 0) : row(NULL) { setsize(rows, cols); }
+  Matrix(const Matrix& M) : row(NULL) { setsize(M.Nrows, M.Ncols); *this = M; }
+  ~Matrix() { delete []row; }
+
+  void setsize(int rows, int cols){
+    Nrows = rows;
+    Ncols = cols;
+    row = Nrows == 0 ? NULL : new Vector[rows];
+    for(int i = 0; i < Nrows; i++)
+      row[i].setsize(cols);
+  }
+
+  Vector& operator[](int i) { return row[i]; }
+  const Vector& operator[](int i) const { return row[i]; }
+
+  const Matrix& operator=(const Matrix& m2){
+    if(Nrows != m2.Nrows || Ncols != m2.Ncols){
+      delete []row;
+      setsize(m2.Nrows, m2.Ncols);
+    }
+    for(int i = 0; i < Nrows; i++)
+      for(int j = 0; j < Ncols; j++)
+        row[i][j] = m2.row[i][j];
+    return *this;
+  }
+
+  friend Matrix operator+(const Matrix& m1, const Matrix& m2){
+    Matrix result(m1.Nrows, m1.Ncols);
+    for(int i = 0; i < m1.Nrows; i++)
+      for(int j = 0; j < m1.Ncols; j++)
+        result.row[i][j] = m1.row[i][j] + m2.row[i][j];
+    return result;
+  }
+
+  Matrix operator*(double a) const {
+    Matrix result(Nrows, Ncols);
+    for(int i = 0; i < Nrows; i++)
+      for(int j = 0; j < Ncols; j++)
+        result[i][j] = a * row[i][j];
+    return result;
+  }
+
+  friend Matrix operator*(const Matrix& m1, const Matrix& m2){
+    Matrix result(m1.Nrows, m2.Ncols);
+    for(int i = 0; i < m1.Nrows; i++)
+      for(int j = 0; j < m2.Ncols; j++){
+        result.row[i][j] = 0;
+        for(int rc = 0; rc < m1.Ncols; rc++)
+          result.row[i][j] += m1.row[i][rc] * m2[rc][j];
+      }
+    return result;
+  }
+
+  friend Vector operator*(const Matrix& M, const Vector& V){
+    Vector result(M.Nrows);
+    for(int i = 0; i < M.Nrows; i++){
+      double sum = 0;
+      for(int j = 0; j < M.Ncols; j++)
+        sum += M[i][j] * V[j];
+      result[i] = sum;
+    }
+    return result;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+/*
+    Warp throughput over source sizes, transforms and filters, what warper does once the transform is
+    known: the output is sized on the forward mapped corners of the source and filled by the kernel
+    the auto selection picks, tile by tile on the thread pool.
+
+    Every case prints output megapixels per second, nanoseconds per output pixel and bytes per output
+    pixel, the source and destination bytes divided by the output pixels: the memory a warp has to
+    touch at most for each pixel it produces. --json writes the same to a file, or stdout for -, to
+    compare runs across commits. Cases with an output over --max-megapixels are skipped.
+
+    usage: warpbench [--sizes 256,1024,4096] [--filters nearest,bilinear,bicubic] [--format uint8]
+                     [--layout interleaved] [--threads n] [--max-megapixels 1024] [--json file]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../warp/kernels.h"
+#include "synthetic.h"
+
+using namespace std;
+
+#define TRANSFORM_COUNT 7
+
+
+/*
+    Forward transforms of a width x height source, the perspective one makes the far corner 2.5 times smaller
+ */
+Matrix3x3 makeTransform(int kind, int width, int height, const char *&name) {
+    double radians = 30.0 * M_PI / 180.0;
+    switch (kind) {
+        case 0:
+            name = "identity";
+            return Matrix3x3(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0);
+        case 1:
+            name = "translate";
+            return Matrix3x3(1.0, 0.0, 13.0, 0.0, 1.0, -7.0, 0.0, 0.0, 1.0);
+        case 2:
+            name = "scale_up";
+            return Matrix3x3(2.0, 0.0, 0.0, 0.0, 2.0, 0.0, 0.0, 0.0, 1.0);
+        case 3:
+            name = "scale_down";
+            return Matrix3x3(0.5, 0.0, 0.0, 0.0, 0.5, 0.0, 0.0, 0.0, 1.0);
+        case 4:
+            name = "rotate_30";
+            return Matrix3x3(cos(radians), -sin(radians), 0.0, sin(radians), cos(radians), 0.0, 0.0, 0.0, 1.0);
+        case 5:
+            name = "shear";
+            return Matrix3x3(1.0, 0.3, 0.0, 0.2, 1.0, 0.0, 0.0, 0.0, 1.0);
+        default:
+            name = "perspective";
+            return Matrix3x3(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 1.0 / width, 0.5 / height, 1.0);
+    }
+}
+
+
+/*
+    Job for the inverse of forward, with the output sized and placed on the bounds of the mapped corners
+ */
+WarpJob makeJob(const ImageView &source, const Matrix3x3 &forward, WarpFilter filter, int &width, int &height) {
+    const double corners_x[4] = {0.0, (double) source.width, 0.0, (double) source.width};
+    const double corners_y[4] = {0.0, 0.0, (double) source.height, (double) source.height};
+    double x[4], y[4];
+    forward.transformPoints(corners_x, corners_y, x, y, 4, true);
+
+    double min_x = HUGE_VAL, max_x = -HUGE_VAL, min_y = HUGE_VAL, max_y = -HUGE_VAL;
+    for (int i = 0; i < 4; i++) {
+        min_x = min(min_x, x[i]);
+        max_x = max(max_x, x[i]);
+        min_y = min(min_y, y[i]);
+        max_y = max(max_y, y[i]);
+    }
+    width = (int) ceil(max_x - floor(min_x));
+    height = (int) ceil(max_y - floor(min_y));
+
+    WarpJob job;
+    job.source = source;
+    job.inverse_matrix = forward.inv();
+    job.origin = Vector3d(floor(min_x), floor(min_y), 0.0);
+    job.isa = detectSimdIsa();
+    job.filter = filter;
+    job.edge = EDGE_BLACK;
+    job.filter_table = buildFilterTable(filter);
+    job.minify = MINIFY_NONE;
+    job.mipmap = NULL;
+    return job;
+}
+
+
+/*
+    Bytes of the pixels of an image, padding included
+ */
+double imageBytes(const ImageView &image) {
+    if (image.layout == LAYOUT_TILED)
+        return (double) image.row_stride * ((image.height + IMAGE_BLOCK_SIZE - 1) >> IMAGE_BLOCK_SHIFT);
+    return (double) image.row_stride * image.height * (image.layout == LAYOUT_PLANAR ? 4 : 1);
+}
+
+
+struct Result {
+    int size;
+    const char *transform;
+    const char *filter;
+    const char *kernel;
+    int width, height;
+    double seconds;             // best run
+    double bytes;               // source and destination
+};
+
+
+/*
+    Best of a few runs after one that pages the destination in, fewer for the large cases
+ */
+double measure(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool) {
+    warpTiled(job, kernel, pool);
+    double best = 1e30, total = 0.0;
+    for (int run = 0; run < 5 and (run < 1 or total < 0.5); run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        warpTiled(job, kernel, pool);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
+
+
+/*
+    Comma separated list of names or numbers
+ */
+vector<string> splitList(const string &list) {
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while (getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+
+void writeJson(FILE *file, const vector<Result> &results, PixelFormat format, ImageLayout layout, int threads) {
+    fprintf(file, "{\n  \"benchmark\": \"warpbench\",\n  \"isa\": \"%s\",\n  \"threads\": %d,\n"
+                  "  \"format\": \"%s\",\n  \"layout\": \"%s\",\n  \"results\": [\n",
+            simdIsaName(detectSimdIsa()), threads, pixelFormatName(format), imageLayoutName(layout));
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        double pixels = (double) r.width * r.height;
+        fprintf(file, "    {\"size\": %d, \"transform\": \"%s\", \"filter\": \"%s\", \"kernel\": \"%s\", "
+                      "\"width\": %d, \"height\": %d, \"seconds\": %.6g, \"megapixels_per_second\": %.6g, "
+                      "\"ns_per_pixel\": %.6g, \"bytes_per_pixel\": %.6g}%s\n",
+                r.size, r.transform, r.filter, r.kernel, r.width, r.height, r.seconds, pixels / r.seconds / 1e6,
+                r.seconds / pixels * 1e9, r.bytes / pixels, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+
+int main(int argc, char **argv) {
+    const char *usage = "usage: %s [--sizes 256,1024,4096] [--filters nearest,bilinear,bicubic] [--format uint8]\n"
+                        "       [--layout interleaved] [--threads n] [--max-megapixels 1024] [--json file]\n";
+    vector<string> size_names = splitList("256,1024,4096"), filter_names = splitList("nearest,bilinear,bicubic");
+    PixelFormat format = FORMAT_UINT8;
+    ImageLayout layout = LAYOUT_INTERLEAVED;
+    int threads = 0;
+    double max_megapixels = 1024.0;
+    const char *json = NULL;
+
+    bool valid = true;
+    for (int i = 1; i < argc and valid; i++) {
+        string argument = argv[i];
+        valid = i + 1 < argc;
+        if (!valid)
+            break;
+        if (argument == "--sizes")
+            size_names = splitList(argv[++i]);
+        else if (argument == "--filters")
+            filter_names = splitList(argv[++i]);
+        else if (argument == "--format")
+            valid = parsePixelFormat(argv[++i], format);
+        else if (argument == "--layout")
+            valid = parseImageLayout(argv[++i], layout);
+        else if (argument == "--threads")
+            threads = atoi(argv[++i]);
+        else if (argument == "--max-megapixels")
+            valid = (max_megapixels = atof(argv[++i])) > 0.0;
+        else if (argument == "--json")
+            json = argv[++i];
+        else
+            valid = false;
+    }
+
+    vector<int> sizes;
+    vector<WarpFilter> filters;
+    for (size_t i = 0; i < size_names.size() and valid; i++) {
+        sizes.push_back(atoi(size_names[i].c_str()));
+        valid = sizes.back() > 0;
+    }
+    for (size_t i = 0; i < filter_names.size() and valid; i++) {
+        filters.push_back(FILTER_NEAREST);
+        valid = parseWarpFilter(filter_names[i], filters.back());
+    }
+    if (!valid or sizes.empty() or filters.empty()) {
+        fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    FILE *table = json and string(json) == "-" ? stderr : stdout;
+    fprintf(table, "%s %s source, %s, %d threads\n", pixelFormatName(format), imageLayoutName(layout),
+            simdIsaName(detectSimdIsa()), pool.threadCount());
+    fprintf(table, "%6s %-12s %-10s %-20s %13s %10s %8s %8s\n", "size", "transform", "filter", "kernel", "output",
+            "MP/s", "ns/px", "B/px");
+
+    vector<Result> results;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        Image source = makeSyntheticImage(size, size, format);
+        if (layout != LAYOUT_INTERLEAVED)
+            source = source.converted(layout);
+        ImageView source_view = source.view();
+        ImageLayout output_layout = layout == LAYOUT_TILED ? LAYOUT_INTERLEAVED : layout;
+
+        for (size_t f = 0; f < filters.size(); f++)
+            for (int kind = 0; kind < TRANSFORM_COUNT; kind++) {
+                Result result;
+                Matrix3x3 forward = makeTransform(kind, size, size, result.transform);
+                WarpJob job = makeJob(source_view, forward, filters[f], result.width, result.height);
+                result.size = size;
+                result.filter = warpFilterName(filters[f]);
+                if ((double) result.width * result.height / 1e6 > max_megapixels) {
+                    fprintf(table, "%6d %-12s %-10s skipped, %dx%d output\n", size, result.transform, result.filter,
+                            result.width, result.height);
+                    continue;
+                }
+
+                Image destination(result.width, result.height, output_layout, format);
+                job.destination = destination.view();
+                WarpKernel kernel = selectWarpKernel(job, WARP_KERNEL_AUTO);
+                result.kernel = warpKernelName(kernel);
+                result.seconds = measure(job, getWarpKernelFunction(kernel), pool);
+                result.bytes = imageBytes(source_view) + imageBytes(job.destination);
+                results.push_back(result);
+
+                double pixels = (double) result.width * result.height;
+                char output[32];
+                snprintf(output, sizeof(output), "%dx%d", result.width, result.height);
+                fprintf(table, "%6d %-12s %-10s %-20s %13s %10.1f %8.2f %8.2f\n", size, result.transform,
+                        result.filter, result.kernel, output, pixels / result.seconds / 1e6,
+                        result.seconds / pixels * 1e9, result.bytes / pixels);
+            }
+    }
+
+    if (json) {
+        FILE *file = string(json) == "-" ? stdout : fopen(json, "w");
+        if (!file) {
+            fprintf(stderr, "cannot write %s\n", json);
+            return 1;
+        }
+        writeJson(file, results, format, layout, pool.threadCount());
+        if (file != stdout)
+            fclose(file);
+    }
+    return 0;
+}
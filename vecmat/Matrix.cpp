@@ -20,384 +20,131 @@ using namespace std;
 /* Matrix Descriptions and Operations */
 
 // Matrix constructors
-Matrix2x2::Matrix2x2(double a11, double a12,
-					 double a21, double a22)
+Matrix::Matrix(int rows, int cols, const double *M) : coeffs(local), Nrows(0), Ncols(0)
 {
-	set(a11, a12, a21, a22);
-}
-
-Matrix3x3::Matrix3x3(double a11, double a12,
-					 double a21, double a22)
-{
-	set(a11, a12, a21, a22);
-}
-
-Matrix3x3::Matrix3x3(double a11, double a12, double a13,
-					 double a21, double a22, double a23,
-					 double a31, double a32, double a33)
-{
-	set(a11, a12, a13, a21, a22, a23, a31, a32, a33);
-}
-
-Matrix4x4::Matrix4x4(double a11, double a12, double a13,
-					 double a21, double a22, double a23,
-					 double a31, double a32, double a33)
-{
-	set(a11, a12, a13, a21, a22, a23, a31, a32, a33);
-}
-
-Matrix4x4::Matrix4x4(double a11, double a12, double a13, double a14,
-					 double a21, double a22, double a23, double a24,
-					 double a31, double a32, double a33, double a34,
-					 double a41, double a42, double a43, double a44)
-{
-	set(a11, a12, a13, a14, a21, a22, a23, a24,
-		a31, a32, a33, a34, a41, a42, a43, a44);
-}
-
-Matrix::Matrix(int rows, int cols, const double *M)
-{
-	int i, j, k;
+	int i;
 	setsize(rows, cols);
 	
 	if(M != NULL)
-		for(i = 0, k = 0; i < rows; i++)
-			for(j = 0; j < cols; j++)
-				(row[i])[j] = M[k++];
+		for(i = 0; i < rows * cols; i++)
+			coeffs[i] = M[i];
 }
 
-Matrix::Matrix(const Matrix& M)
+Matrix::Matrix(const Matrix& M) : coeffs(local), Nrows(0), Ncols(0)
 {
-	int i, j;
-	
-	setsize(M.Nrows, M.Ncols);
-	for(i = 0; i < Nrows; i++)
-		for(j = 0; j < Ncols; j++)
-			row[i][j] = M.row[i][j];
+	*this = M;
+}
+
+Matrix::Matrix(Matrix&& M)
+{
+	take(M);
 }
 
 Matrix::Matrix(double a11, double a12,
-			   double a21, double a22)
+			   double a21, double a22) : coeffs(local), Nrows(0), Ncols(0)
 {
-	setsize(2, 2);
-	row[0].set(a11, a12);
-	row[1].set(a21, a22);
+	allocate(2, 2);
+	set(a11, a12, a21, a22);
 }
 
 Matrix::Matrix(double a11, double a12, double a13,
 			   double a21, double a22, double a23,
-			   double a31, double a32, double a33)
+			   double a31, double a32, double a33) : coeffs(local), Nrows(0), Ncols(0)
 {
-	setsize(3, 3);
-	row[0].set(a11, a12, a13);
-	row[1].set(a21, a22, a23);
-	row[2].set(a31, a32, a33);
+	allocate(3, 3);
+	set(a11, a12, a13, a21, a22, a23, a31, a32, a33);
 }
 
 Matrix::Matrix(double a11, double a12, double a13, double a14,
 			   double a21, double a22, double a23, double a24,
 			   double a31, double a32, double a33, double a34,
-			   double a41, double a42, double a43, double a44)
+			   double a41, double a42, double a43, double a44) : coeffs(local), Nrows(0), Ncols(0)
 {
-	setsize(4, 4);
-	row[0].set(a11, a12, a13, a14);
-	row[1].set(a21, a22, a23, a24);
-	row[2].set(a31, a32, a33, a34);
-	row[3].set(a41, a42, a43, a44);
+	allocate(4, 4);
+	set(a11, a12, a13, a14, a21, a22, a23, a24,
+		a31, a32, a33, a34, a41, a42, a43, a44);
 }
 
 // Destructor
 Matrix::~Matrix()
 {
-	delete []row;
+	release();
 }
 
-void Matrix::setsize(int rows, int cols)
+//
+// Storage: one row-major block, in the local array up to 4 x 4 so small
+// matrices are created, copied and returned without touching the heap
+//
+void Matrix::allocate(int rows, int cols)
 {
-	int i;
-	
 	if(rows < 0 || cols < 0 || ((rows == 0 || cols == 0) && cols != rows)){
 		cerr << "Matrix size impossible (negative or zero rows or cols)" << endl;
 		exit(1);
 	}
 	Nrows = rows;
 	Ncols = cols;
-	
-	if(Nrows == 0)
-		row = NULL;
-	else{
-		row = new Vector[rows];
-		if(!row){
-			cerr << "not enough memory to allocate " << rows << " x " << cols << 
-			" Matrix" << endl;
-			exit(1);
-		}
-		for(i = 0; i < rows; i++)
-			row[i].setsize(cols);
-	}
-	
-}
-
-int Matrix::nrows() const
-{
-	return Nrows;
+	coeffs = rows * cols <= MATRIX_LOCAL_SIZE ? local : new double[rows * cols];
 }
 
-int Matrix::ncols() const
+void Matrix::release()
 {
-	return Ncols;
+	if(coeffs != local)
+		delete []coeffs;
+	coeffs = local;
+	Nrows = Ncols = 0;
 }
 
-//
-// return row i of matrix as a vector
-// Routines returning an lvalue: i.e. M[i] returns ref to row i
-//
-Vector2d& Matrix2x2::operator[](int i)
-{
-	if(i < 0 || i > 1){
-		cerr << "Matrix2x2 row index " << i << " out of bounds" << endl;
-		exit(1);
-	}
-	
-	return (row[i]);
-}
-Vector3d& Matrix3x3::operator[](int i)
+void Matrix::take(Matrix& M)
 {
-	if(i < 0 || i > 2){
-		cerr << "Matrix3x3 row index " << i << " out of bounds" << endl;
-		exit(1);
+	Nrows = M.Nrows;
+	Ncols = M.Ncols;
+	if(M.coeffs == M.local){
+		coeffs = local;
+		memcpy(local, M.local, Nrows * Ncols * sizeof(double));
 	}
-	
-	return (row[i]);
+	else
+		coeffs = M.coeffs;
+	M.coeffs = M.local;
+	M.Nrows = M.Ncols = 0;
 }
-Vector4d& Matrix4x4::operator[](int i)
+
+// Set size of Matrix, all coefficients 0
+void Matrix::setsize(int rows, int cols)
 {
-	if(i < 0 || i > 3){
-		cerr << "Matrix4x4 row index " << i << " out of bounds" << endl;
-		exit(1);
-	}
+	int i;
 	
-	return (row[i]);
+	release();
+	allocate(rows, cols);
+	for(i = 0; i < rows * cols; i++)
+		coeffs[i] = 0;
 }
-Vector& Matrix::operator[](int i)
+
+//
+// return row i of matrix as a pointer to its first coefficient
+// Routines returning an lvalue: i.e. M[i][j] returns ref to coefficient
+//
+double* Matrix::operator[](int i)
 {
 	if(i < 0 || i >= Nrows){
 		cerr << "Matrix row index of " << i << " out of bounds" << endl;
 		exit(1);
 	}
 	
-	return (row[i]);
+	return coeffs + i * Ncols;
 }
 
 //
-// return row i of matrix as a vector
-// Routines returning an rvalue: i.e. X[i] returns const ref to row i
+// return row i of matrix as a pointer to its first coefficient
+// Routines returning an rvalue: i.e. M[i][j] returns const ref to coefficient
 //
-const Vector2d& Matrix2x2::operator[](int i) const
-{
-	if(i < 0 || i > 1){
-		cerr << "Matrix2x2 row index " << i << " out of bounds" << endl;
-		exit(1);
-	}
-	
-	return (row[i]);
-}
-const Vector3d& Matrix3x3::operator[](int i) const
-{
-	if(i < 0 || i > 2){
-		cerr << "Matrix3x3 row index " << i << " out of bounds" << endl;
-		exit(1);
-	}
-	
-	return (row[i]);
-}
-const Vector4d& Matrix4x4::operator[](int i) const
-{
-	if(i < 0 || i > 3){
-		cerr << "Matrix4x4 row index " << i << " out of bounds" << endl;
-		exit(1);
-	}
-	
-	return (row[i]);
-}
-const Vector& Matrix::operator[](int i) const
+const double* Matrix::operator[](int i) const
 {
 	if(i < 0 || i >= Nrows){
 		cerr << "Matrix row index of " << i << " out of bounds" << endl;
 		exit(1);
 	}
 	
-	return (row[i]);
-}
-
-// Casts of Matrices into other forms of Matrices
-Matrix2x2::operator Matrix3x3()
-{
-	Matrix3x3 m;
-	int i, j;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++)
-			m[i][j] = row[i][j];
-	
-	m[2].z = 1.0;
-	
-	return m;
-}
-
-Matrix2x2::operator Matrix4x4()
-{
-	Matrix4x4 m;
-	int i, j;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++)
-			m[i][j] = row[i][j];
-	
-	m[2].z = 1.0;
-	m[3].w = 1.0;
-	
-	return m;
-}
-
-Matrix2x2::operator Matrix()
-{
-	Matrix m(2, 2);
-	int i, j;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++)
-			m[i][j] = row[i][j];
-	
-	return m;
-}
-
-Matrix3x3::operator Matrix4x4()
-{
-	Matrix4x4 m;
-	int i, j;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			m[i][j] = row[i][j];
-	
-	m[3].w = 1.0;
-	
-	return m;
-}
-
-Matrix3x3::operator Matrix()
-{
-	Matrix m(3, 3);
-	int i, j;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			m[i][j] = row[i][j];
-	
-	return m;
-}
-
-Matrix4x4::operator Matrix()
-{
-	Matrix m(4, 4);
-	int i, j;
-	
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			m[i][j] = row[i][j];
-	
-	return m;
-}
-
-Matrix::operator Matrix2x2()
-{
-	if(Nrows != 2 || Ncols != 2){
-		cerr << "cannot cast " << Nrows << " x " << Ncols << 
-		" Matrix to Matrix2x2" << endl;
-		exit(1);
-	}
-	
-	Matrix2x2 m;
-	int i, j;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++)
-			m[i][j] = row[i][j];
-	
-	return m;  
-}
-
-Matrix::operator Matrix3x3()
-{
-	if(Nrows != 3 || Ncols != 3){
-		cerr << "cannot cast " << Nrows << " x " << Ncols << 
-		" Matrix to Matrix3x3" << endl;
-		exit(1);
-	}
-	
-	Matrix3x3 m;
-	int i, j;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			m[i][j] = row[i][j];
-	
-	return m;  
-}
-
-Matrix::operator Matrix4x4()
-{
-	if(Nrows != 4 || Ncols != 4){
-		cerr << "cannot cast " << Nrows << " x " << Ncols << 
-		" Matrix to Matrix4x4" << endl;
-		exit(1);
-	}
-	
-	Matrix4x4 m;
-	int i, j;
-	
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			m[i][j] = row[i][j];
-	
-	return m;  
-}
-
-void Matrix2x2::print(int w, int p) const
-{
-	int i;
-	
-	for(i = 0; i < 2; i++){
-		cout << setw(w) << setprecision(p) << Round(row[i].x, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].y, p);
-		cout << endl;
-	}
-}
-
-void Matrix3x3::print(int w, int p) const
-{
-	int i;
-	
-	for(i = 0; i < 3; i++){
-		cout << setw(w) << setprecision(p) << Round(row[i].x, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].y, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].z, p);
-		cout << endl;
-	}
-}
-
-void Matrix4x4::print(int w, int p) const
-{
-	int i;
-	
-	for(i = 0; i < 4; i++){
-		cout << setw(w) << setprecision(p) << Round(row[i].x, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].y, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].z, p) << " ";
-		cout << setw(w) << setprecision(p) << Round(row[i].w, p);
-		cout << endl;
-	}
+	return coeffs + i * Ncols;
 }
 
 void Matrix::print(int w, int p) const
@@ -406,63 +153,17 @@ void Matrix::print(int w, int p) const
 	
 	for(i = 0; i < Nrows; i++){
 		for(j = 0; j < Ncols; j++)
-			cout << setw(w) << setprecision(p) << Round(row[i][j], p) << " ";
+			cout << setw(w) << setprecision(p) << Round(coeffs[i * Ncols + j], p) << " ";
 		cout << endl;
 	}
 }
 
-void Matrix2x2::set(double a11, double a12,
-					double a21, double a22)
-{
-	row[0].set(a11, a12);
-	row[1].set(a21, a22);
-}
-
-void Matrix3x3::set(double a11, double a12,
-					double a21, double a22)
-{
-	row[0].set(a11, a12, 0);
-	row[1].set(a21, a22, 0);
-	row[2].set(0, 0, 1);
-}
-
-void Matrix3x3::set(double a11, double a12, double a13,
-					double a21, double a22, double a23,
-					double a31, double a32, double a33)
-{
-	row[0].set(a11, a12, a13);
-	row[1].set(a21, a22, a23);
-	row[2].set(a31, a32, a33);
-}
-
-void Matrix4x4::set(double a11, double a12, double a13,
-					double a21, double a22, double a23,
-					double a31, double a32, double a33)
-{
-	row[0].set(a11, a12, a13, 0);
-	row[1].set(a21, a22, a23, 0);
-	row[2].set(a31, a32, a33, 0);
-	row[3].set(0, 0, 0, 1);
-}
-
-void Matrix4x4::set(double a11, double a12, double a13, double a14,
-					double a21, double a22, double a23, double a24,
-					double a31, double a32, double a33, double a34,
-					double a41, double a42, double a43, double a44)
-{
-	row[0].set(a11, a12, a13, a14);
-	row[1].set(a21, a22, a23, a24);
-	row[2].set(a31, a32, a33, a34);
-	row[3].set(a41, a42, a43, a44);
-}
-
 void Matrix::set(double *M)
 {
-	int i, j;
+	int i;
 	
-	for(i = 0; i < Nrows; i++)
-		for(j = 0; j < Ncols; j++)
-			row[i][j] = M[i * Ncols + j];
+	for(i = 0; i < Nrows * Ncols; i++)
+		coeffs[i] = M[i];
 }
 
 void Matrix::set(double a11, double a12,
@@ -472,8 +173,8 @@ void Matrix::set(double a11, double a12,
 		cerr << "2 x 2 set of " << Nrows << " x " << Ncols << " Matrix" << endl;
 		exit(1);
 	}
-	row[0].set(a11, a12);
-	row[1].set(a21, a22);
+	double M[] = {a11, a12, a21, a22};
+	set(M);
 }
 
 void Matrix::set(double a11, double a12, double a13,
@@ -485,9 +186,8 @@ void Matrix::set(double a11, double a12, double a13,
 		" Matrix" << endl;
 		exit(1);
 	}
-	row[0].set(a11, a12, a13);
-	row[1].set(a21, a22, a23);
-	row[2].set(a31, a32, a33);
+	double M[] = {a11, a12, a13, a21, a22, a23, a31, a32, a33};
+	set(M);
 }
 
 void Matrix::set(double a11, double a12, double a13, double a14,
@@ -499,25 +199,9 @@ void Matrix::set(double a11, double a12, double a13, double a14,
 		cerr << "4 x 4 set of " << Nrows << " x " << Ncols << " Matrix" << endl;
 		exit(1);
 	}
-	row[0].set(a11, a12, a13, a14);
-	row[1].set(a21, a22, a23, a24);
-	row[2].set(a31, a32, a33, a34);
-	row[3].set(a41, a42, a43, a44);
-}
-
-void Matrix2x2::identity()
-{
-	set(1, 0, 0, 1);
-}
-
-void Matrix3x3::identity()
-{
-	set(1, 0, 0, 0, 1, 0, 0, 0, 1);
-}
-
-void Matrix4x4::identity()
-{
-	set(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	double M[] = {a11, a12, a13, a14, a21, a22, a23, a24,
+		a31, a32, a33, a34, a41, a42, a43, a44};
+	set(M);
 }
 
 void Matrix::identity()
@@ -527,231 +211,34 @@ void Matrix::identity()
 	for(i = 0; i < Nrows; i++)
 		for(j = 0; j < Ncols; j++)
 			if(i == j)
-				row[i][j] = 1;
+				coeffs[i * Ncols + j] = 1;
 			else
-				row[i][j] = 0;
-}
-
-Matrix2x2 Matrix2x2::transpose() const
-{
-	Matrix2x2 transM;
-	
-	transM[0].x = row[0].x;
-	transM[1].x = row[0].y;
-	transM[0].y = row[1].x;
-	transM[1].y = row[1].y;
-	
-	return transM;
-}
-
-Matrix3x3 Matrix3x3::transpose() const
-{
-	Matrix3x3 transM;
-	
-	transM[0].x = row[0].x;
-	transM[1].x = row[0].y;
-	transM[2].x = row[0].z;
-	transM[0].y = row[1].x;
-	transM[1].y = row[1].y;
-	transM[2].y = row[1].z;
-	transM[0].z = row[2].x;
-	transM[1].z = row[2].y;
-	transM[2].z = row[2].z;
-	
-	return transM;
-}
-
-Matrix4x4 Matrix4x4::transpose() const
-{
-	Matrix4x4 transM;
-	
-	transM[0].x = row[0].x;
-	transM[1].x = row[0].y;
-	transM[2].x = row[0].z;
-	transM[3].x = row[0].w;
-	transM[0].y = row[1].x;
-	transM[1].y = row[1].y;
-	transM[2].y = row[1].z;
-	transM[3].y = row[1].w;
-	transM[0].z = row[2].x;
-	transM[1].z = row[2].y;
-	transM[2].z = row[2].z;
-	transM[3].z = row[2].w;
-	transM[0].w = row[3].x;
-	transM[1].w = row[3].y;
-	transM[2].w = row[3].z;
-	transM[3].w = row[3].w;
-	
-	return transM;
+				coeffs[i * Ncols + j] = 0;
 }
 
 Matrix Matrix::transpose() const
 {
 	Matrix transM(Ncols, Nrows);
-	int i, j;
-	
-	for(i = 0; i < Nrows; i++)
-		for(j = 0; j < Ncols; j++)
-			transM[j][i] = row[i][j];
-	
-	return transM;
-}
-
-//////////////////////////////////////////////////////////////////////////
-// the following matrix operations are used to find the inverse of an 
-// NxN matrix. Adapted from Numerical Recipes by (Frank) Sebastian Grassia
-//////////////////////////////////////////////////////////////////////////
-
-Matrix2x2 Matrix2x2::inv() const
-{
-	Matrix2x2 invM;
-	double d;
-	
-	d = row[0].x*row[1].y - row[0].y*row[1].x;
-	
-	if(d == 0.0)
-		cerr << "inverse of singular Matrix2x2" << endl;
-	
-	invM[0].x = row[1].y / d;
-	invM[0].y = -row[0].y / d;
-	invM[1].x = -row[1].x / d;
-	invM[1].y = row[0].x / d;
-	
-	return invM;
-}
-
-Matrix3x3 Matrix3x3::inv() const
-{
-	Matrix3x3 invM;
-	double d;
-	
-	d = row[0].x*row[1].y*row[2].z + row[0].y*row[1].z*row[2].x +
-    row[0].z*row[2].y*row[1].x - row[0].z*row[1].y*row[2].x - 
-    row[0].y*row[1].x*row[2].z - row[0].x*row[2].y*row[1].z;
-	
-	if(d == 0.0)
-		cerr << "inverse of singular Matrix3x3" << endl;
-	
-	invM[0].x = (row[1].y*row[2].z - row[1].z*row[2].y) / d;
-	invM[0].y = (row[0].z*row[2].y - row[0].y*row[2].z) / d;
-	invM[0].z = (row[0].y*row[1].z - row[0].z*row[1].y) / d;
-	invM[1].x = (row[1].z*row[2].x - row[1].x*row[2].z) / d;
-	invM[1].y = (row[0].x*row[2].z - row[0].z*row[2].x) / d;
-	invM[1].z = (row[0].z*row[1].x - row[0].x*row[1].z) / d;
-	invM[2].x = (row[1].x*row[2].y - row[1].y*row[2].x) / d;
-	invM[2].y = (row[0].y*row[2].x - row[0].x*row[2].y) / d;
-	invM[2].z = (row[0].x*row[1].y - row[0].y*row[1].x) / d;
-	
-	return invM;
-}
-
-Matrix4x4 LU_Decompose(const Matrix4x4& M, int *indx)
-{
-	int  i, imax, j, k;
-	double big, dum, sum, temp;
-	double vv[4];
-	Matrix4x4 LU_M = M;
-	int N = 4;
-	
-	for(i = 0; i < N; i++){
-		big = 0.0;
-		for(j = 0; j < N; j++)
-			if((temp = fabs(M.row[i][j])) > big)
-				big = temp;
-		if(big == 0.0)
-			cerr << "inverse of singular Matrix4x4" << endl;
-		
-		vv[i] = 1.0 / big;
-	}
-	
-	for(j = 0; j < N; j++){
-		for(i = 0; i < j; i++){
-			sum = LU_M[i][j];
-			for(k = 0; k < i; k++)
-				sum -= LU_M[i][k] * LU_M[k][j];
-			LU_M[i][j] = sum;
-		}
-		big = 0.0;
-		for(i = j; i < N; i++){
-			sum = LU_M[i][j];
-			for(k = 0; k < j; k++)
-				sum -= LU_M[i][k] * LU_M[k][j];
-			LU_M[i][j] = sum;
-			if((dum = vv[i]*fabs(sum)) >= big){
-				big = dum;
-				imax = i;
-			}
-		}
-		if(j != imax){
-			for(k = 0; k < N; k++){
-				dum = LU_M[imax][k];
-				LU_M[imax][k] = LU_M[j][k];
-				LU_M[j][k] = dum;
-			}
-			vv[imax] = vv[j];
-		}
-		indx[j] = imax;
-		if(j < N - 1){
-			dum = 1.0 / LU_M[j][j];
-			for(i = j + 1; i < N; i++)
-				LU_M[i][j] *= dum;
-		}
-	}
-	
-	return LU_M;
-}
-
-void LU_back_substitution(const Matrix4x4& M, int *indx, double col[])
-{
-	int i, ii = -1, ip,j;
-	double sum;
-	int N = 4;
-	
-	for(i = 0; i < N; i++){
-		ip = indx[i];
-		sum = col[ip];
-		col[ip] = col[i];
-		if(ii >= 0)
-			for(j = ii; j < i; j++)
-				sum -= M.row[i][j] * col[j];
-		else if(sum)
-			ii = i;
-		col[i] = sum;
-	}
-	
-	for(i = N - 1; i >= 0; i--){
-		sum = col[i];
-		for(j = i + 1; j < N; j++)
-			sum -= M.row[i][j] * col[j];
-		col[i] = sum / M.row[i][i];
-	}
-}
-
-Matrix4x4 Matrix4x4::inv() const
-{
-	Matrix4x4 LU_M, invM;
-	int i, j, indx[4];
-	double col[4];
-	
-	LU_M = LU_Decompose(*this, indx);
+	int i, j;
 	
-	for(j = 0; j < 4; j++){
-		for(i = 0; i < 4; i++)
-			col[i] = 0.0;
-		col[j] = 1.0;
-		LU_back_substitution(LU_M, indx, col);
-		for(i = 0; i < 4; i++)
-			invM[i][j] = col[i];
-	}
+	for(i = 0; i < Nrows; i++)
+		for(j = 0; j < Ncols; j++)
+			transM.coeffs[j * Nrows + i] = coeffs[i * Ncols + j];
 	
-	return invM;
+	return transM;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// the following matrix operations are used to find the inverse of an 
+// NxN matrix. Adapted from Numerical Recipes by (Frank) Sebastian Grassia
+//////////////////////////////////////////////////////////////////////////
+
 Matrix LU_Decompose(const Matrix& M, int *indx)
 {
 	int  i, imax, j, k;
 	double big, dum, sum, temp;
-	double *vv = new double[M.Nrows];
+	double local_vv[4];
+	double *vv = M.Nrows <= 4 ? local_vv : new double[M.Nrows];
 	Matrix LU_M(M);
 	int N = M.Nrows;
 	
@@ -801,7 +288,8 @@ Matrix LU_Decompose(const Matrix& M, int *indx)
 		}
 	}
 	
-	delete vv;
+	if(vv != local_vv)
+		delete []vv;
 	return LU_M;
 }
 
@@ -817,7 +305,7 @@ void LU_back_substitution(const Matrix& M, int *indx, double col[])
 		col[ip] = col[i];
 		if(ii >= 0)
 			for(j = ii; j < i; j++)
-				sum -= M.row[i][j] * col[j];
+				sum -= M.coeffs[i * N + j] * col[j];
 		else if(sum)
 			ii = i;
 		col[i] = sum;
@@ -826,8 +314,8 @@ void LU_back_substitution(const Matrix& M, int *indx, double col[])
 	for(i = N - 1; i >= 0; i--){
 		sum = col[i];
 		for(j = i + 1; j < N; j++)
-			sum -= M.row[i][j] * col[j];
-		col[i] = sum / M.row[i][i];
+			sum -= M.coeffs[i * N + j] * col[j];
+		col[i] = sum / M.coeffs[i * N + i];
 	}
 }
 
@@ -842,8 +330,10 @@ Matrix Matrix::inv() const
 	Matrix LU_M(Nrows, Nrows);
 	Matrix invM(Nrows, Nrows);
 	int i, j;
-	int *indx = new int[Nrows];
-	double *col = new double[Nrows];
+	int local_indx[4];
+	double local_col[4];
+	int *indx = Nrows <= 4 ? local_indx : new int[Nrows];
+	double *col = Nrows <= 4 ? local_col : new double[Nrows];
 	
 	LU_M = LU_Decompose(*this, indx);
 	
@@ -856,8 +346,10 @@ Matrix Matrix::inv() const
 			invM[i][j] = col[i];
 	}
 	
-	delete indx;
-	delete col;
+	if(indx != local_indx){
+		delete []indx;
+		delete []col;
+	}
 	return invM;
 }
 
@@ -1120,510 +612,49 @@ Matrix diag(const Vector &V)
 	return d;
 }
 
-/* Matrix op Matrix operations */
-
-Matrix2x2 operator+(const Matrix2x2& m1, const Matrix2x2& m2)
-{
-	int i;
-	Matrix2x2 result;
-	
-	for(i = 0; i < 2; i++){
-		result.row[i].x = m1.row[i].x + m2.row[i].x;
-		result.row[i].y = m1.row[i].y + m2.row[i].y;
-	}
-	
-	return result;
-}
-
-Matrix2x2 operator-(const Matrix2x2& m1, const Matrix2x2& m2)
-{
-	int i;
-	Matrix2x2 result;
-	
-	for(i = 0; i < 2; i++){
-		result.row[i].x = m1.row[i].x - m2.row[i].x;
-		result.row[i].y = m1.row[i].y - m2.row[i].y;
-	}
-	
-	return result;
-}
-
-Matrix2x2 operator*(double a, const Matrix2x2& m)
-{
-	int i;
-	Matrix2x2 result;
-	
-	for(i = 0; i < 2; i++){
-		result.row[i].x = a * m.row[i].x;
-		result.row[i].y = a * m.row[i].y;
-	}
-	
-	return result;
-}
-
-Matrix2x2 Matrix2x2::operator*(double a) const
-{
-	int i;
-	Matrix2x2 result;
-	
-	for(i = 0; i < 2; i++){
-		result.row[i].x = a * row[i].x;
-		result.row[i].y = a * row[i].y;
-	}
-	
-	return result;
-}
-
-ostream& operator<< (ostream& os, const Matrix2x2& m){
-	int i, j;
-	
-	for(i = 0; i < 2; i++){
-		for(j = 0; j < 2; j++)
-			os << setw(7) << setprecision(3) << Round(m.row[i][j], 3) << " ";
-		os << endl;
-	}
-	
-	return os;
-}
-
-
-Matrix2x2 operator*(const Matrix2x2& m1, const Matrix2x2& m2)
-{
-	int i, j, rc;
-	Matrix2x2 result;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++){
-			result.row[i][j] = 0;
-			for(rc = 0; rc < 2; rc++)
-				result.row[i][j] += m1.row[i][rc] * m2.row[rc][j];
-		}
-	
-	return result;
-}
-
-Matrix3x3 operator+(const Matrix3x3& m1, const Matrix3x3& m2)
-{
-	int i, j;
-	Matrix3x3 result;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			result.row[i][j] = m1.row[i][j] + m2.row[i][j];
-	
-	return result;
-}
-
-Matrix3x3 operator-(const Matrix3x3& m1, const Matrix3x3& m2)
-{
-	int i, j;
-	Matrix3x3 result;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			result.row[i][j] = m1.row[i][j] - m2.row[i][j];
-	
-	return result;
-}
-
-Matrix3x3 operator*(double a, const Matrix3x3& m)
-{
-	Matrix3x3 result;
-	int i, j;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			result.row[i][j] = a * m.row[i][j];
-	
-	return result;
-}
-
-Matrix3x3 Matrix3x3::operator*(double a) const
-{
-	Matrix3x3 result;
-	int i, j;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			result[i][j] = a * row[i][j];
-	
-	return result;
-}
-
-ostream& operator<< (ostream& os, const Matrix3x3& m){
-	int i, j;
-	
-	for(i = 0; i < 3; i++){
-		for(j = 0; j < 3; j++)
-			os << setw(7) << setprecision(3) << Round(m.row[i][j], 3) << " ";
-		os << endl;
-	}
-	
-	return os;
-}
-
-
-Matrix3x3 operator*(const Matrix3x3& m1, const Matrix3x3& m2)
-{
-	int i, j, rc;
-	Matrix3x3 result;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++){
-			result.row[i][j] = 0;
-			for(rc = 0; rc < 3; rc++)
-				result.row[i][j] += m1.row[i][rc] * m2[rc][j];
-		}
-	
-	return result;
-}
-
-Matrix4x4 operator+(const Matrix4x4& m1, const Matrix4x4& m2)
-{
-	int i, j;
-	Matrix4x4 result;
-	
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			result.row[i][j] = m1.row[i][j] + m2.row[i][j];
-	
-	return result;
-}
-
-Matrix4x4 operator-(const Matrix4x4& m1, const Matrix4x4& m2)
-{
-	int i, j;
-	Matrix4x4 result;
-	
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			result.row[i][j] = m1.row[i][j] - m2.row[i][j];
-	
-	return result;
-}
-
-Matrix4x4 operator*(double a, const Matrix4x4& m)
-{
-	Matrix4x4 result;
-	
-	int i, j;
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			result.row[i][j] = a * m.row[i][j];
-	
-	return result;
-}
-
-Matrix4x4 Matrix4x4::operator*(double a) const
-{
-	Matrix4x4 result;
-	
-	int i, j;
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++)
-			result[i][j] = a * row[i][j];
-	
-	return result;
-}
-
-ostream& operator<< (ostream& os, const Matrix4x4& m){
-	int i, j;
-	
-	for(i = 0; i < 4; i++){
-		for(j = 0; j < 4; j++)
-			os << setw(7) << setprecision(3) << Round(m.row[i][j], 3) << " ";
-		os << endl;
-	}
-	
-	return os;
-}
-
-Matrix4x4 operator*(const Matrix4x4& m1, const Matrix4x4& m2)
-{
-	int i, j, rc;
-	Matrix4x4 result;
-	
-	for(i = 0; i < 4; i++)
-		for(j = 0; j < 4; j++){
-			result.row[i][j] = 0;
-			for(rc = 0; rc < 4; rc++)
-				result.row[i][j] += m1.row[i][rc] * m2[rc][j];
-		}
-	
-	return result;
-}
-
-Matrix operator+(const Matrix& m1, const Matrix& m2)
-{
-	if(m1.Nrows != m2.Nrows || m1.Ncols != m2.Ncols){
-		cerr << "cannot add " << m1.Nrows << " x " << m1.Ncols << 
-		" Matrix to " << m2.Nrows << " x " << m2.Ncols << " Matrix" << endl;
-		exit(1);
-	}
-	Matrix result(m1.Nrows, m1.Ncols);
-	
-	int i, j;
-	for(i = 0; i < m1.Nrows; i++)
-		for(j = 0; j < m1.Ncols; j++)
-			result.row[i][j] = m1.row[i][j] + m2.row[i][j];
-	
-	return result;
-}
-
-Matrix operator-(const Matrix& m1, const Matrix& m2)
-{
-	if(m1.Nrows != m2.Nrows || m1.Ncols != m2.Ncols){
-		cerr << "cannot subtract " << m2.Nrows << " x " << m2.Ncols << " Matrix from " << m1.Nrows << " x " << m1.Ncols << " Matrix" << endl;
-		exit(1);
-	}
-	Matrix result(m1.Nrows, m1.Ncols);
-	
-	int i, j;
-	for(i = 0; i < m1.Nrows; i++)
-		for(j = 0; j < m1.Ncols; j++)
-			result.row[i][j] = m1.row[i][j] - m2.row[i][j];
-	
-	return result;
-}
-
-Matrix operator*(double a, const Matrix& m)
-{
-	Matrix result(m.Nrows, m.Ncols);
-	
-	int i, j;
-	for(i = 0; i < m.Nrows; i++)
-		for(j = 0; j < m.Ncols; j++)
-			result.row[i][j] = a * m.row[i][j];
-	
-	return result;
-}
-
-Matrix Matrix::operator*(double a) const
-{
-	Matrix result(Nrows, Ncols);
-	
-	int i, j;
-	for(i = 0; i < Nrows; i++)
-		for(j = 0; j < Ncols; j++)
-			result[i][j] = a * row[i][j];
-	
-	return result;
-}
+/* Matrix op Matrix operations: sums, differences and products are
+   expressions, see Matrix.h */
 
 ostream& operator<< (ostream& os, const Matrix& m){
 	int i, j;
 	
 	for(i = 0; i < m.Nrows; i++){
 		for(j = 0; j < m.Ncols; j++)
-			os << setw(7) << setprecision(3) << Round(m.row[i][j], 3) << " ";
+			os << setw(7) << setprecision(3) << Round(m.coeffs[i * m.Ncols + j], 3) << " ";
 		os << endl;
 	}
 	
 	return os;
 }
 
-Matrix operator*(const Matrix& m1, const Matrix& m2)
-{
-	if(m1.Ncols != m2.Nrows){
-		cerr << "cannot multiply " << m2.Nrows << " x " << m2.Ncols << 
-		" Matrix by " << m1.Nrows << " x " << m1.Ncols << " Matrix" << endl;
-		exit(1);
-	}
-	Matrix result(m1.Nrows, m2.Ncols);
-	
-	int i, j, rc;
-	for(i = 0; i < m1.Nrows; i++)
-		for(j = 0; j < m2.Ncols; j++){
-			result.row[i][j] = 0;
-			for(rc = 0; rc < m1.Ncols; rc++)
-				result.row[i][j] += m1.row[i][rc] * m2[rc][j];
-		}
-	
-	return result;
-}
 
 // Assignment
 const Matrix& Matrix::operator=(const Matrix& m2)
 {
-	int i, j;
-	
 	if(Nrows != m2.Nrows || Ncols != m2.Ncols){
-		delete []row;
-		setsize(m2.Nrows, m2.Ncols);
+		release();
+		allocate(m2.Nrows, m2.Ncols);
 	}
 	
-	for(i = 0; i < Nrows; i++)
-		for(j = 0; j < Ncols; j++)
-			(row[i])[j] = (m2.row[i])[j];
+	if(this != &m2)
+		memcpy(coeffs, m2.coeffs, Nrows * Ncols * sizeof(double));
 	
 	return (*this);
 }
 
-/* Matrix-Vector Operations */
-
-Vector2d operator*(const Matrix2x2& m, const Vector2d& v)
-{
-	int i, j;
-	double sum;
-	Vector2d result;
-	
-	for(i = 0; i < 2; i++){
-		sum = 0;
-		for(j = 0; j < 2; j++)
-			sum += m.row[i][j] * v[j];
-		result[i] = sum;
-	}
-	
-	return result;
-}
-
-Vector3d operator*(const Matrix3x3& m, const Vector3d& v)
-{
-	int i, j;
-	double sum;
-	Vector3d result;
-	
-	for(i = 0; i < 3; i++){
-		sum = 0;
-		for(j = 0; j < 3; j++)
-			sum += m.row[i][j] * v[j];
-		result[i] = sum;
-	}
-	
-	return result;
-}
-
-Vector4d operator*(const Matrix4x4& m, const Vector4d& v)
-{
-	int i, j;
-	double sum;
-	Vector4d result;
-	
-	for(i = 0; i < 4; i++){
-		sum = 0;
-		for(j = 0; j < 4; j++)
-			sum += m.row[i][j] * v[j];
-		result[i] = sum;
-	}
-	
-	return result;
-}
-
-Vector operator*(const Matrix& M, const Vector& V)
-{
-	if(M.Ncols != V.getn()){
-		cerr << "multiply of " << M.Nrows << " x " << M.Ncols << 
-		" Matrix by " << V.getn() << " Vector" << endl;
-		exit(1);
-	}
-	
-	int i, j;
-	double sum;
-	Vector result(M.Nrows);
-	
-	for(i = 0; i < M.Nrows; i++){
-		sum = 0;
-		for(j = 0; j < M.Ncols; j++)
-			sum += M[i][j] * V[j];
-		result[i] = sum;
-	}
-	
-	return result;
-}
-
-Vector2d operator*(const Vector2d& v, const Matrix2x2& m)
-{
-	int i, j;
-	double sum;
-	Vector2d result;
-	
-	for(j = 0; j < 2; j++){
-		sum = 0;
-		for(i = 0; i < 2; i++)
-			sum += v[i] * m.row[i][j];
-		result[j] = sum;
-	}
-	
-	return result;
-}
-
-Vector3d operator*(const Vector3d& v, const Matrix3x3& m)
-{
-	int i, j;
-	double sum;
-	Vector3d result;
-	
-	for(j = 0; j < 3; j++){
-		sum = 0;
-		for(i = 0; i < 3; i++)
-			sum += v[i] * m.row[i][j];
-		result[j] = sum;
-	}
-	
-	return result;
-}
-
-Vector4d operator*(const Vector4d& v, const Matrix4x4& m)
+const Matrix& Matrix::operator=(Matrix&& m2)
 {
-	int i, j;
-	double sum;
-	Vector4d result;
-	
-	for(j = 0; j < 4; j++){
-		sum = 0;
-		for(i = 0; i < 4; i++)
-			sum += v[i] * m.row[i][j];
-		result[j] = sum;
+	if(this != &m2){
+		release();
+		take(m2);
 	}
 	
-	return result;
+	return (*this);
 }
 
-Vector operator*(const Vector& V, const Matrix& M)
-{
-	if(M.Nrows != V.getn()){
-		cerr << "multiply of " << V.getn() << " Vector by " << M.Nrows << 
-		" x " << M.Ncols << " Matrix" << endl;
-		exit(1);
-	}
-	
-	int i, j;
-	double sum;
-	Vector result(M.Nrows);
-	
-	for(j = 0; j < M.Ncols; j++){
-		sum = 0;
-		for(i = 0; i < M.Nrows; i++)
-			sum += M[i][j] * V[i];
-		result[j] = sum;
-	}
-	
-	return result;
-}
+/* Matrix-Vector Operations: products are expressions, see Matrix.h */
 
 // Outer product of v1, v2 (i.e. v1 times v2 transpose)
-Matrix2x2 operator&(const Vector2d& v1, const Vector2d& v2)
-{
-	int i, j;
-	Matrix2x2 product;
-	
-	for(i = 0; i < 2; i++)
-		for(j = 0; j < 2; j++)
-			product.row[i][j] = v1[i] * v2[j];
-	
-	return product;
-}
-Matrix3x3 operator&(const Vector3d& v1, const Vector3d& v2)
-{
-	int i, j;
-	Matrix3x3 product;
-	
-	for(i = 0; i < 3; i++)
-		for(j = 0; j < 3; j++)
-			product.row[i][j] = v1[i] * v2[j];
-	
-	return product;
-}
 Matrix operator&(const Vector& v1, const Vector& v2)
 {
 	int N = v1.getn();
@@ -1638,7 +669,7 @@ Matrix operator&(const Vector& v1, const Vector& v2)
 	
 	for(i = 0; i < N; i++)
 		for(j = 0; j < N; j++)
-			product.row[i][j] = v1[i] * v2[j];
+			product.coeffs[i * N + j] = v1[i] * v2[j];
 	
 	return product;
 }
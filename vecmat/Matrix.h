@@ -18,156 +18,53 @@
 
 /* Matrix Descriptions and Operations */
 
-class Matrix2x2;
-class Matrix3x3;
-class Matrix4x4;
 class Matrix;
 
 //
 // The internal storage form of transforms.  The matrices in row-major
-// order (ie  mat[row][column] )
+// order (ie  mat[row][column] ), fixed size ones are in VecMat.h
 //
+typedef Mat<double, 2, 2> Matrix2x2;
+typedef Mat<double, 3, 3> Matrix3x3;
+typedef Mat<double, 4, 4> Matrix4x4;
+typedef Mat<float, 2, 2> Matrix2x2f;
+typedef Mat<float, 3, 3> Matrix3x3f;
+typedef Mat<float, 4, 4> Matrix4x4f;
 
-class Matrix2x2 {
-protected:
-  Vector2d row[2];
-
+//
+// Matrix arithmetic builds expressions like Vector arithmetic does, see
+// Vector.h. A matrix expression E provides nrows(), ncols(), the
+// coefficient at(i, j) and aliases(p). The methods below evaluate the
+// expression first.
+//
+template <typename E>
+class MatrixExpression {
 public:
-  Matrix2x2(double a11 = 0, double a12 = 0,
-	    double a21 = 0, double a22 = 0);
-
-  Vector2d& operator[](int i);
-  const Vector2d& operator[](int i) const;
-
-  operator Matrix3x3();
-  operator Matrix4x4();
-  operator Matrix();
-
-  void print(int w = 7, int p = 3) const; // print with width and precision
-
-  void set(double a11 = 0, double a12 = 0,
-	   double a21 = 0, double a22 = 0);
-  void identity();
-
-  Matrix2x2 transpose() const;
-  Matrix2x2 inv() const;
+  const E& self() const { return static_cast<const E&>(*this); }
 
-  friend Matrix2x2 operator+(const Matrix2x2& m1, const Matrix2x2& m2);
-  friend Matrix2x2 operator-(const Matrix2x2& m1, const Matrix2x2& m2);
-  friend Matrix2x2 operator*(const Matrix2x2& m1, const Matrix2x2& m2);
-  friend Matrix2x2 operator*(double a, const Matrix2x2& m);
-  Matrix2x2 operator*(double a) const;
-  friend ostream& operator<< (ostream& os, const Matrix2x2& m);
-
-  // mat times vector
-  friend Vector2d operator*(const Matrix2x2& m, const Vector2d& v);
-  // vector times mat
-  friend Vector2d operator*(const Vector2d& v, const Matrix2x2& m);
-  // outer product
-  friend Matrix2x2 operator&(const Vector2d& v1, const Vector2d& v2);
+  Matrix eval() const;
+  Matrix transpose() const;
+  Matrix inv() const;
+  void print(int w = 7, int p = 3) const;
 };
 
-class Matrix3x3 {
-protected:
-  Vector3d row[3];
-
-public:
-  Matrix3x3(double a11 = 0, double a12 = 0,
-	    double a21 = 0, double a22 = 0);
-  Matrix3x3(double a11, double a12, double a13,
-	    double a21, double a22, double a23,
-	    double a31, double a32, double a33);
-
-  Vector3d& operator[](int i);
-  const Vector3d& operator[](int i) const;
-
-  operator Matrix4x4();
-  operator Matrix();
+// matrices of up to this many coefficients (4 x 4) are stored in place
+#define MATRIX_LOCAL_SIZE	16
 
-  void print(int w = 7, int p = 3) const;  // print with width and precision
-
-  void set(double a11 = 0, double a12 = 0,
-	   double a21 = 0, double a22 = 0);
-  void set(double a11, double a12, double a13,
-	   double a21, double a22, double a23,
-	   double a31, double a32, double a33);
-  void identity();
-
-  Matrix3x3 transpose() const;
-  Matrix3x3 inv() const;
-
-  friend Matrix3x3 operator+(const Matrix3x3& m1, const Matrix3x3& m2);
-  friend Matrix3x3 operator-(const Matrix3x3& m1, const Matrix3x3& m2);
-  friend Matrix3x3 operator*(const Matrix3x3& m1, const Matrix3x3& m2);
-  friend Matrix3x3 operator*(double a, const Matrix3x3& m);
-  Matrix3x3 operator*(double a) const;
-  friend ostream& operator<< (ostream& os, const Matrix3x3& m);
-
-  // mat times vector
-  friend Vector3d operator*(const Matrix3x3& m, const Vector3d& v);
-  // vector times mat
-  friend Vector3d operator*(const Vector3d& v, const Matrix3x3& m);
-  // outer product
-  friend Matrix3x3 operator&(const Vector3d& v1, const Vector3d& v2);
-};
-
-class Matrix4x4 {
+class Matrix : public MatrixExpression<Matrix> {
 protected:
-  Vector4d row[4];
-
-public:
-  Matrix4x4(double a11 = 0, double a12 = 0, double a13 = 0,
-	    double a21 = 0, double a22 = 0, double a23 = 0,
-	    double a31 = 0, double a32 = 0, double a33 = 0);
-  Matrix4x4(double a11, double a12, double a13, double a14,
-	    double a21, double a22, double a23, double a24,
-	    double a31, double a32, double a33, double a34,
-	    double a41, double a42, double a43, double a44);
-
-  operator Matrix();
-
-  Vector4d& operator[](int i);
-  const Vector4d& operator[](int i) const;
-
-  void print(int w = 7, int p = 3) const;  // print with width and precision
-
-  void set(double a11 = 0, double a12 = 0, double a13 = 0,
-	   double a21 = 0, double a22 = 0, double a23 = 0,
-	   double a31 = 0, double a32 = 0, double a33 = 0);
-  void set(double a11, double a12, double a13, double a14,
-	   double a21, double a22, double a23, double a24,
-	   double a31, double a32, double a33, double a34,
-	   double a41, double a42, double a43, double a44);
-  void identity();
-
-  Matrix4x4 transpose() const;
-  Matrix4x4 inv() const;
-
-  friend Matrix4x4 operator+(const Matrix4x4& m1, const Matrix4x4& m2);
-  friend Matrix4x4 operator-(const Matrix4x4& m1, const Matrix4x4& m2);
-  friend Matrix4x4 operator*(const Matrix4x4& m1, const Matrix4x4& m2);
-  friend Matrix4x4 operator*(double a, const Matrix4x4& m);
-  Matrix4x4 operator*(double a) const;
-  friend ostream& operator<< (ostream& os, const Matrix4x4& m);
-
-  friend Matrix4x4 LU_Decompose(const Matrix4x4& M, int *indx);
-  friend void LU_back_substitution(const Matrix4x4& M, int *indx, double col[]);
-  // mat times vector
-  friend Vector4d operator*(const Matrix4x4& m, const Vector4d& v);
-  // vector times mat
-  friend Vector4d operator*(const Vector4d& v, const Matrix4x4& m);
-  // outer product
-  friend Matrix4x4 operator&(const Vector4d& v1, const Vector4d& v2);
-};
-
-class Matrix {
-protected:
-  Vector *row;
+  double *coeffs;		// Nrows * Ncols, row-major: local or allocated
   int Nrows, Ncols;
+  double local[MATRIX_LOCAL_SIZE];
+
+  void allocate(int rows, int cols);	// coeffs for rows x cols, not initialized
+  void release();			// back to a 0 x 0 matrix
+  void take(Matrix& M);			// storage of M, leaving M empty
 
 public:
   Matrix(int rows = 0, int cols = 0, const double *M = NULL);
   Matrix(const Matrix& M);
+  Matrix(Matrix&& M);
   Matrix(double a11, double a12,
 	 double a21, double a22);
   Matrix(double a11, double a12, double a13,
@@ -177,19 +74,22 @@ public:
 	 double a21, double a22, double a23, double a24,
 	 double a31, double a32, double a33, double a34,
 	 double a41, double a42, double a43, double a44);
+  template <int R, int C> Matrix(const Mat<double, R, C>& M);
+  template <typename E> Matrix(const MatrixExpression<E>& e);
 
   ~Matrix();
 
   void setsize(int rows, int cols);
-  int nrows() const;
-  int ncols() const;
+  int nrows() const { return Nrows; }
+  int ncols() const { return Ncols; }
+  double at(int i, int j) const { return coeffs[i * Ncols + j]; }	// unchecked
+  bool aliases(const void *) const { return false; }
 
-  operator Matrix2x2();
-  operator Matrix3x3();
-  operator Matrix4x4();
+  template <int R, int C> operator Mat<double, R, C>() const;
 
-  Vector& operator[](int i);
-  const Vector& operator[](int i) const;
+  // row i, M[i][j] is the coefficient in row i, column j
+  double* operator[](int i);
+  const double* operator[](int i) const;
 
   void print(int w = 7, int p = 3) const;  // print with width and precision
 
@@ -210,23 +110,273 @@ public:
   void svd(Matrix &U, Vector &W, Matrix &V) const;
  
   const Matrix& operator=(const Matrix& m2);
-  friend Matrix operator+(const Matrix& m1, const Matrix& m2);
-  friend Matrix operator-(const Matrix& m1, const Matrix& m2);
-  friend Matrix operator*(const Matrix& m1, const Matrix& m2);
-  friend Matrix operator*(double a, const Matrix& m);
-  Matrix operator*(double a) const;
+  const Matrix& operator=(Matrix&& m2);
+  template <typename E> const Matrix& operator=(const MatrixExpression<E>& e);
   friend ostream& operator<< (ostream& os, const Matrix& m);
 
   friend Matrix LU_Decompose(const Matrix& M, int *indx);
   friend void LU_back_substitution(const Matrix& M, int *indx, double col[]);
-  // mat times vector
-  friend Vector operator*(const Matrix& m, const Vector& v); 
-  // vector times mat
-  friend Vector operator*(const Vector& v, const Matrix& m);
   // outer product
   friend Matrix operator&(const Vector& v1, const Vector& v2);
 };
 
 Matrix diag(const Vector &V);
+Matrix operator&(const Vector& v1, const Vector& v2);	// outer product
+
+template <int R, int C>
+Matrix::Matrix(const Mat<double, R, C>& M) : coeffs(local), Nrows(0), Ncols(0)
+{
+  allocate(R, C);
+  for(int i = 0; i < R; i++)
+    for(int j = 0; j < C; j++)
+      coeffs[i * C + j] = M[i][j];
+}
+
+template <typename E>
+Matrix::Matrix(const MatrixExpression<E>& e) : coeffs(local), Nrows(0), Ncols(0)
+{
+  *this = e;
+}
+
+template <typename E>
+const Matrix& Matrix::operator=(const MatrixExpression<E>& e)
+{
+  const E& x = e.self();
+  if(x.aliases(this))
+    return *this = Matrix(x);
+
+  if(Nrows != x.nrows() || Ncols != x.ncols()){
+    release();
+    allocate(x.nrows(), x.ncols());
+  }
+  for(int i = 0; i < Nrows; i++)
+    for(int j = 0; j < Ncols; j++)
+      coeffs[i * Ncols + j] = x.at(i, j);
+  return *this;
+}
+
+template <int R, int C>
+Matrix::operator Mat<double, R, C>() const
+{
+  if(Nrows != R || Ncols != C){
+    cerr << "cannot cast " << Nrows << " x " << Ncols << 
+      " Matrix to " << R << " x " << C << " Matrix" << endl;
+    exit(1);
+  }
+
+  Mat<double, R, C> m;
+  for(int i = 0; i < R; i++)
+    for(int j = 0; j < C; j++)
+      m[i][j] = coeffs[i * C + j];
+  return m;
+}
+
+/* Matrix expressions */
+
+template <typename E>
+inline Matrix MatrixExpression<E>::eval() const
+{
+  return Matrix(*this);
+}
+
+template <typename E>
+inline Matrix MatrixExpression<E>::transpose() const
+{
+  return eval().transpose();
+}
+
+template <typename E>
+inline Matrix MatrixExpression<E>::inv() const
+{
+  return eval().inv();
+}
+
+template <typename E>
+inline void MatrixExpression<E>::print(int w, int p) const
+{
+  eval().print(w, p);
+}
+
+template <typename E>
+inline ostream& operator<< (ostream& os, const MatrixExpression<E>& e)
+{
+  return os << e.eval();
+}
+
+template <typename A, typename B>
+class MatrixSum : public MatrixExpression<MatrixSum<A, B> > {
+  const A& a;
+  const B& b;
+
+public:
+  MatrixSum(const A& a, const B& b) : a(a), b(b){
+    if(a.nrows() != b.nrows() || a.ncols() != b.ncols()){
+      cerr << "cannot add " << a.nrows() << " x " << a.ncols() << 
+	" Matrix to " << b.nrows() << " x " << b.ncols() << " Matrix" << endl;
+      exit(1);
+    }
+  }
+
+  int nrows() const { return a.nrows(); }
+  int ncols() const { return a.ncols(); }
+  double at(int i, int j) const { return a.at(i, j) + b.at(i, j); }
+  bool aliases(const void *p) const { return a.aliases(p) || b.aliases(p); }
+};
+
+template <typename A, typename B>
+class MatrixDifference : public MatrixExpression<MatrixDifference<A, B> > {
+  const A& a;
+  const B& b;
+
+public:
+  MatrixDifference(const A& a, const B& b) : a(a), b(b){
+    if(a.nrows() != b.nrows() || a.ncols() != b.ncols()){
+      cerr << "cannot subtract " << b.nrows() << " x " << b.ncols() << 
+	" Matrix from " << a.nrows() << " x " << a.ncols() << " Matrix" << endl;
+      exit(1);
+    }
+  }
+
+  int nrows() const { return a.nrows(); }
+  int ncols() const { return a.ncols(); }
+  double at(int i, int j) const { return a.at(i, j) - b.at(i, j); }
+  bool aliases(const void *p) const { return a.aliases(p) || b.aliases(p); }
+};
+
+template <typename A>
+class MatrixScale : public MatrixExpression<MatrixScale<A> > {
+  const A& a;
+  double s;
+
+public:
+  MatrixScale(const A& a, double s) : a(a), s(s) {}
+
+  int nrows() const { return a.nrows(); }
+  int ncols() const { return a.ncols(); }
+  double at(int i, int j) const { return s * a.at(i, j); }
+  bool aliases(const void *p) const { return a.aliases(p); }
+};
+
+// operand of a product, see VectorOperand
+template <typename E> struct MatrixOperand { typedef Matrix type; };
+template <> struct MatrixOperand<Matrix> { typedef const Matrix& type; };
+
+// products read other coefficients of their operands than the one they compute
+template <typename A, typename B>
+class MatrixProduct : public MatrixExpression<MatrixProduct<A, B> > {
+  typename MatrixOperand<A>::type a;
+  typename MatrixOperand<B>::type b;
+
+public:
+  MatrixProduct(const A& m1, const B& m2) : a(m1), b(m2){
+    if(a.ncols() != b.nrows()){
+      cerr << "cannot multiply " << b.nrows() << " x " << b.ncols() << 
+	" Matrix by " << a.nrows() << " x " << a.ncols() << " Matrix" << endl;
+      exit(1);
+    }
+  }
+
+  int nrows() const { return a.nrows(); }
+  int ncols() const { return b.ncols(); }
+  double at(int i, int j) const {
+    double sum = 0;
+    for(int k = 0; k < a.ncols(); k++)
+      sum += a.at(i, k) * b.at(k, j);
+    return sum;
+  }
+  bool aliases(const void *p) const { return &a == p || &b == p; }
+};
+
+// mat times vector
+template <typename A, typename B>
+class MatrixVectorProduct : public VectorExpression<MatrixVectorProduct<A, B> > {
+  typename MatrixOperand<A>::type m;
+  typename VectorOperand<B>::type v;
+
+public:
+  MatrixVectorProduct(const A& M, const B& V) : m(M), v(V){
+    if(m.ncols() != v.getn()){
+      cerr << "multiply of " << m.nrows() << " x " << m.ncols() << 
+	" Matrix by " << v.getn() << " Vector" << endl;
+      exit(1);
+    }
+  }
+
+  int getn() const { return m.nrows(); }
+  double at(int i) const {
+    double sum = 0;
+    for(int j = 0; j < m.ncols(); j++)
+      sum += m.at(i, j) * v.at(j);
+    return sum;
+  }
+  bool aliases(const void *p) const { return &m == p || &v == p; }
+};
+
+// vector times mat
+template <typename A, typename B>
+class VectorMatrixProduct : public VectorExpression<VectorMatrixProduct<A, B> > {
+  typename VectorOperand<A>::type v;
+  typename MatrixOperand<B>::type m;
+
+public:
+  VectorMatrixProduct(const A& V, const B& M) : v(V), m(M){
+    if(m.nrows() != v.getn()){
+      cerr << "multiply of " << v.getn() << " Vector by " << m.nrows() << 
+	" x " << m.ncols() << " Matrix" << endl;
+      exit(1);
+    }
+  }
+
+  int getn() const { return m.ncols(); }
+  double at(int j) const {
+    double sum = 0;
+    for(int i = 0; i < m.nrows(); i++)
+      sum += m.at(i, j) * v.at(i);
+    return sum;
+  }
+  bool aliases(const void *p) const { return &m == p || &v == p; }
+};
+
+template <typename A, typename B>
+inline MatrixSum<A, B> operator+(const MatrixExpression<A>& a, const MatrixExpression<B>& b)
+{
+  return MatrixSum<A, B>(a.self(), b.self());
+}
+
+template <typename A, typename B>
+inline MatrixDifference<A, B> operator-(const MatrixExpression<A>& a, const MatrixExpression<B>& b)
+{
+  return MatrixDifference<A, B>(a.self(), b.self());
+}
+
+template <typename A>
+inline MatrixScale<A> operator*(double s, const MatrixExpression<A>& a)
+{
+  return MatrixScale<A>(a.self(), s);
+}
+
+template <typename A>
+inline MatrixScale<A> operator*(const MatrixExpression<A>& a, double s)
+{
+  return MatrixScale<A>(a.self(), s);
+}
+
+template <typename A, typename B>
+inline MatrixProduct<A, B> operator*(const MatrixExpression<A>& a, const MatrixExpression<B>& b)
+{
+  return MatrixProduct<A, B>(a.self(), b.self());
+}
+
+template <typename A, typename B>
+inline MatrixVectorProduct<A, B> operator*(const MatrixExpression<A>& m, const VectorExpression<B>& v)
+{
+  return MatrixVectorProduct<A, B>(m.self(), v.self());
+}
+
+template <typename A, typename B>
+inline VectorMatrixProduct<A, B> operator*(const VectorExpression<A>& v, const MatrixExpression<B>& m)
+{
+  return VectorMatrixProduct<A, B>(v.self(), m.self());
+}
 
 #endif
@@ -0,0 +1,142 @@
+/********************************************************************
+
+	VecMat.cpp	Source File
+
+	Batched Point Transforms of 3 x 3 Matrices
+
+	Every point is evaluated as (m00 x + m01 y) + m02 and so on in
+	the precision of the coefficients, then divided by its third
+	component. The AVX2 loops do 4 points at a time in double and 8
+	in float with the same operations, so their results are bit for
+	bit those of the scalar loop.
+
+*********************************************************************/
+
+#include "VecMat.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define VECMAT_SIMD_X86
+#endif
+
+using namespace std;
+
+namespace vecmat {
+
+template <typename M, typename P>
+static void transformScalar(const M *m, const P *xs, const P *ys, P *outX, P *outY, size_t first,
+			    size_t n, bool projective)
+{
+  for(size_t i = first; i < n; i++){
+    M x = xs[i], y = ys[i];
+    M hx = m[0] * x + m[1] * y + m[2];
+    M hy = m[3] * x + m[4] * y + m[5];
+    if(projective){
+      M hw = m[6] * x + m[7] * y + m[8];
+      hx /= hw;
+      hy /= hw;
+    }
+    outX[i] = P(hx);
+    outY[i] = P(hy);
+  }
+}
+
+#ifdef VECMAT_SIMD_X86
+
+__attribute__((target("avx2")))
+static inline __m256d load4(const double *p) { return _mm256_loadu_pd(p); }
+__attribute__((target("avx2")))
+static inline __m256d load4(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+__attribute__((target("avx2")))
+static inline void store4(double *p, __m256d v) { _mm256_storeu_pd(p, v); }
+__attribute__((target("avx2")))
+static inline void store4(float *p, __m256d v) { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); }
+
+// the points in whole groups of 4, returns how many were done
+template <typename P>
+__attribute__((target("avx2")))
+static size_t transformAvx2(const double *m, const P *xs, const P *ys, P *outX, P *outY, size_t n,
+			    bool projective)
+{
+  __m256d c[9];
+  for(int k = 0; k < 9; k++)
+    c[k] = _mm256_set1_pd(m[k]);
+
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4){
+    __m256d x = load4(xs + i), y = load4(ys + i);
+    __m256d hx = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[0], x), _mm256_mul_pd(c[1], y)), c[2]);
+    __m256d hy = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[3], x), _mm256_mul_pd(c[4], y)), c[5]);
+    if(projective){
+      __m256d hw = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[6], x), _mm256_mul_pd(c[7], y)), c[8]);
+      hx = _mm256_div_pd(hx, hw);
+      hy = _mm256_div_pd(hy, hw);
+    }
+    store4(outX + i, hx);
+    store4(outY + i, hy);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static size_t transformAvx2(const float *m, const float *xs, const float *ys, float *outX, float *outY, size_t n,
+			    bool projective)
+{
+  __m256 c[9];
+  for(int k = 0; k < 9; k++)
+    c[k] = _mm256_set1_ps(m[k]);
+
+  size_t i = 0;
+  for(; i + 8 <= n; i += 8){
+    __m256 x = _mm256_loadu_ps(xs + i), y = _mm256_loadu_ps(ys + i);
+    __m256 hx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0], x), _mm256_mul_ps(c[1], y)), c[2]);
+    __m256 hy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[3], x), _mm256_mul_ps(c[4], y)), c[5]);
+    if(projective){
+      __m256 hw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[6], x), _mm256_mul_ps(c[7], y)), c[8]);
+      hx = _mm256_div_ps(hx, hw);
+      hy = _mm256_div_ps(hy, hw);
+    }
+    _mm256_storeu_ps(outX + i, hx);
+    _mm256_storeu_ps(outY + i, hy);
+  }
+  return i;
+}
+
+static bool avx2Supported()
+{
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+#endif
+
+template <typename M, typename P>
+static void transform(const M *m, const P *xs, const P *ys, P *outX, P *outY, size_t n, bool projective)
+{
+  size_t done = 0;
+#ifdef VECMAT_SIMD_X86
+  if(avx2Supported())
+    done = transformAvx2(m, xs, ys, outX, outY, n, projective);
+#endif
+  transformScalar(m, xs, ys, outX, outY, done, n, projective);
+}
+
+void transformPoints(const float *m, const float *xs, const float *ys, float *outX, float *outY, size_t n,
+		     bool projective)
+{
+  transform(m, xs, ys, outX, outY, n, projective);
+}
+
+void transformPoints(const double *m, const float *xs, const float *ys, float *outX, float *outY, size_t n,
+		     bool projective)
+{
+  transform(m, xs, ys, outX, outY, n, projective);
+}
+
+void transformPoints(const double *m, const double *xs, const double *ys, double *outX, double *outY,
+		     size_t n, bool projective)
+{
+  transform(m, xs, ys, outX, outY, n, projective);
+}
+
+}
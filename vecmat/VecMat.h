@@ -0,0 +1,617 @@
+/********************************************************************
+
+	VecMat.h	Header File
+
+	Fixed Size Vector and Matrix Templates
+
+	Vec<T, N> and Mat<T, R, C> hold their components in place, in
+	one contiguous row-major block, and are defined entirely in this
+	header so every operation can be inlined, except the batched
+	point transforms of 3 x 3 matrices in VecMat.cpp. Nothing
+	allocates.
+	Vector2d ... Vector4d and Matrix2x2 ... Matrix4x4 are the double
+	instances, see Vector.h and Matrix.h.
+
+	Index checks are compiled in unless NDEBUG is defined.
+
+*********************************************************************/
+
+#ifndef _H_VecMat
+#define _H_VecMat
+
+#include <cstddef>
+#include <type_traits>
+#include "Utility.h"
+using namespace std;
+
+template <typename T, int N> class Vec;
+template <typename T, int R, int C> class Mat;
+
+namespace vecmat {
+
+// compile time index lists, to build vectors and matrices in constant expressions
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+// true if every type is a number, which keeps the component constructors away from copies
+template <typename... Args> struct Arithmetic : std::true_type {};
+template <typename A, typename... Rest> struct Arithmetic<A, Rest...>
+  : std::integral_constant<bool, std::is_arithmetic<A>::value && Arithmetic<Rest...>::value> {};
+
+inline void indexError(const char *what, int i, int n)
+{
+  std::cerr << what << " index " << i << " out of bounds for size " << n << std::endl;
+  exit(1);
+}
+
+}
+
+#ifdef NDEBUG
+#define VECMAT_CHECK_INDEX(what, i, n)	((void) 0)
+#else
+#define VECMAT_CHECK_INDEX(what, i, n)	((i) < 0 || (i) >= (n) ? vecmat::indexError(what, i, n) : (void) 0)
+#endif
+
+/*
+  N component vector. Vec<T, 4> is a homogeneous point: dividing or
+  normalizing it sets w to 1, and == ignores w.
+*/
+template <typename T, int N>
+class Vec {
+  T v[N];
+
+  template <typename U, int... I>
+  constexpr Vec(const Vec<U, N> &a, vecmat::Indices<I...>) : v{T(a[I])...} {}
+
+  template <int M, int... I>
+  constexpr Vec<T, M> padded(vecmat::Indices<I...>) const {
+    return Vec<T, M>((I < N ? v[I < N ? I : 0] : T(0))...);
+  }
+
+public:
+  typedef T value_type;
+
+  constexpr Vec() : v{} {}
+
+  // Vec(x, y, ...) with up to N components, the rest are 0
+  template <typename... Args, typename = typename std::enable_if<
+            (sizeof...(Args) > 0) && vecmat::Arithmetic<Args...>::value>::type>
+  constexpr Vec(Args... a) : v{T(a)...} {
+    static_assert(sizeof...(Args) <= N, "too many components for vector");
+  }
+
+  // change of component type
+  template <typename U>
+  explicit constexpr Vec(const Vec<U, N> &a) : Vec(a, typename vecmat::MakeIndices<N>::type()) {}
+
+  // projection into a higher dimension, the new components are 0
+  template <int M, typename = typename std::enable_if<(M > N)>::type>
+  constexpr operator Vec<T, M>() const {
+    return padded<M>(typename vecmat::MakeIndices<M>::type());
+  }
+
+  T& operator[](int i) {
+    VECMAT_CHECK_INDEX("vector", i, N);
+    return v[i];
+  }
+  constexpr const T& operator[](int i) const {
+    return VECMAT_CHECK_INDEX("vector", i, N), v[i];
+  }
+
+  T *data() { return v; }
+  constexpr const T *data() const { return v; }
+
+  void print() const { cout << *this; }
+  void print(int w, int p) const {	// print with width and precision
+    cout << "[";
+    for(int i = 0; i < N; i++)
+      cout << (i ? " " : "") << setw(w) << setprecision(p) << Round(v[i], p);
+    cout << "]";
+  }
+
+  T norm() const { return sqrt(normsqr()); }	// magnitude of vector
+  T normsqr() const {				// magnitude squared
+    T s = Sqr(v[0]);
+    for(int i = 1; i < N; i++)
+      s += Sqr(v[i]);
+    return s;
+  }
+  Vec normalize() const;			// normalize
+  Vec wnorm() const;				// normalize to w coord., 4d only
+
+  template <typename... Args, typename = typename std::enable_if<vecmat::Arithmetic<Args...>::value>::type>
+  void set(Args... a) { *this = Vec(a...); }
+  void set(const Vec &a) { *this = a; }
+
+  friend Vec operator-(const Vec &a) {		// unary negation
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = -a.v[i];
+    return r;
+  }
+  friend Vec operator+(const Vec &a, const Vec &b) {
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = a.v[i] + b.v[i];
+    return r;
+  }
+  friend Vec operator-(const Vec &a, const Vec &b) {
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = a.v[i] - b.v[i];
+    return r;
+  }
+  friend Vec operator*(const Vec &a, T s) {	// scalar multiply
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = a.v[i] * s;
+    return r;
+  }
+  friend Vec operator*(T s, const Vec &a) {
+    return a * s;
+  }
+  friend T operator*(const Vec &a, const Vec &b) {	// dot product
+    T p = a.v[0] * b.v[0];
+    for(int i = 1; i < N; i++)
+      p += a.v[i] * b.v[i];
+    return p;
+  }
+  friend Vec operator^(const Vec &a, const Vec &b) {	// component *
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = a.v[i] * b.v[i];
+    return r;
+  }
+  friend Vec operator/(const Vec &a, T s) {	// division by scalar
+    Vec r;
+    for(int i = 0; i < N; i++)
+      r.v[i] = a.v[i] / s;
+    if(N == 4)
+      r.v[N - 1] = 1;
+    return r;
+  }
+  friend short operator==(const Vec &a, const Vec &b) {
+    for(int i = 0; i < (N == 4 ? 3 : N); i++)
+      if(a.v[i] != b.v[i])
+	return 0;
+    return 1;
+  }
+  friend ostream& operator<<(ostream &os, const Vec &a) {
+    os << "[" << a.v[0];
+    for(int i = 1; i < N; i++)
+      os << " " << a.v[i];
+    os << "]";
+    return os;
+  }
+};
+
+template <typename T, int N>
+Vec<T, N> Vec<T, N>::normalize() const
+{
+  const int n = N == 4 ? 3 : N;		// w of a homogeneous point stays 1
+  T magnitude = norm();
+  for(int i = 0; i < n; i++)
+    if(Abs(v[i]) > magnitude * HUGENUMBER){
+      cerr << "Attempting to take the norm of a zero " << N << "D vector." << endl;
+      break;
+    }
+
+  Vec r;
+  for(int i = 0; i < n; i++)
+    r.v[i] = v[i] / magnitude;
+  if(N == 4)
+    r.v[N - 1] = 1;
+  return r;
+}
+
+//  Normalize a 4D Vector's x, y, z components by the w component, and
+//  set the w component to 1.0
+template <typename T, int N>
+Vec<T, N> Vec<T, N>::wnorm() const
+{
+  static_assert(N == 4, "w-normalizing needs a 4D vector");
+  if(v[3] == 1)
+    return *this;
+  else if(Abs(v[3]) < SMALLNUMBER)
+    cerr << "w-Normalizing vector " << *this << " w ~= 0!" << endl;
+
+  return Vec(v[0] / v[3], v[1] / v[3], v[2] / v[3], 1);
+}
+
+// Cross product of two Vectors, 2d vectors give [0 0 z]
+template <typename T>
+inline Vec<T, 3> operator%(const Vec<T, 2> &a, const Vec<T, 2> &b)
+{
+  return Vec<T, 3>(0, 0, a[0] * b[1] - a[1] * b[0]);
+}
+
+template <typename T>
+inline Vec<T, 3> operator%(const Vec<T, 3> &a, const Vec<T, 3> &b)
+{
+  return Vec<T, 3>(a[1] * b[2] - a[2] * b[1],
+		   a[2] * b[0] - a[0] * b[2],
+		   a[0] * b[1] - a[1] * b[0]);
+}
+
+template <typename T>
+inline Vec<T, 4> operator%(const Vec<T, 4> &a, const Vec<T, 4> &b)
+{
+  cerr << "sorry, cross product of Vector4d's not yet implemented" << endl;
+  exit(1);
+  return a;
+}
+
+/*
+  R x C matrix, stored as R row vectors. A square matrix of size 3 or
+  more given only the entries of its upper (R-1) x (C-1) block, or
+  nothing, gets 1 in the bottom right corner: Matrix3x3(a11, a12, a21,
+  a22) is the homogeneous form of a 2d linear map.
+*/
+template <typename T, int R, int C>
+class Mat {
+  Vec<T, C> row[R];
+
+  enum { homogeneous = R == C && R >= 3 };
+
+  template <typename U, int... I>
+  constexpr Mat(const Mat<U, R, C> &a, vecmat::Indices<I...>) : row{Vec<T, C>(a[I])...} {}
+
+  template <int K, int... I>
+  constexpr Mat(const Vec<T, K> &a, bool block, vecmat::Indices<I...>)
+    : row{rowOf(a, I, block, typename vecmat::MakeIndices<C>::type())...} {}
+
+  template <int K, int... J>
+  static constexpr Vec<T, C> rowOf(const Vec<T, K> &a, int i, bool block, vecmat::Indices<J...>) {
+    return Vec<T, C>(entry(a, i, J, block)...);
+  }
+
+  // entry (i, j) from the row-major list a, or from a list of the upper block
+  template <int K>
+  static constexpr T entry(const Vec<T, K> &a, int i, int j, bool block) {
+    return !block ? (i * C + j < K ? a[i * C + j] : T(0)) :
+      i < R - 1 && j < C - 1 ? (i * (C - 1) + j < K ? a[i * (C - 1) + j] : T(0)) :
+      i == R - 1 && j == C - 1 ? T(1) : T(0);
+  }
+
+public:
+  typedef T value_type;
+
+  constexpr Mat() : Mat(Vec<T, 1>(), homogeneous, typename vecmat::MakeIndices<R>::type()) {}
+
+  // Mat(a11, a12, ..., aRC) in row-major order, see above for the upper block form
+  template <typename... Args, typename = typename std::enable_if<
+            (sizeof...(Args) > 0) && vecmat::Arithmetic<Args...>::value>::type>
+  constexpr Mat(Args... a)
+    : Mat(Vec<T, sizeof...(Args)>(a...), homogeneous && sizeof...(Args) <= (R - 1) * (C - 1),
+	  typename vecmat::MakeIndices<R>::type()) {
+    static_assert(sizeof...(Args) <= R * C && (!homogeneous || sizeof...(Args) <= (R - 1) * (C - 1) ||
+		  sizeof...(Args) == R * C), "wrong number of matrix entries");
+  }
+
+  // change of component type
+  template <typename U>
+  explicit constexpr Mat(const Mat<U, R, C> &a) : Mat(a, typename vecmat::MakeIndices<R>::type()) {}
+
+  // embedding into a larger square matrix, with 1 on the new diagonal
+  template <int M, typename = typename std::enable_if<(M > R) && R == C>::type>
+  operator Mat<T, M, M>() const {
+    Mat<T, M, M> m;
+    for(int i = 0; i < M; i++)
+      for(int j = 0; j < M; j++)
+	m[i][j] = i < R && j < C ? row[i][j] : T(i == j);
+    return m;
+  }
+
+  Vec<T, C>& operator[](int i) {
+    VECMAT_CHECK_INDEX("matrix row", i, R);
+    return row[i];
+  }
+  constexpr const Vec<T, C>& operator[](int i) const {
+    return VECMAT_CHECK_INDEX("matrix row", i, R), row[i];
+  }
+
+  // the R * C entries in row-major order
+  T *data() { return row[0].data(); }
+  constexpr const T *data() const { return row[0].data(); }
+
+  void print(int w = 7, int p = 3) const {	// print with width and precision
+    for(int i = 0; i < R; i++){
+      for(int j = 0; j < C; j++)
+	cout << (j ? " " : "") << setw(w) << setprecision(p) << Round(row[i][j], p);
+      cout << endl;
+    }
+  }
+
+  template <typename... Args, typename = typename std::enable_if<vecmat::Arithmetic<Args...>::value>::type>
+  void set(Args... a) { *this = Mat(a...); }
+  void identity() {
+    for(int i = 0; i < R; i++)
+      for(int j = 0; j < C; j++)
+	row[i][j] = T(i == j);
+  }
+
+  Mat<T, C, R> transpose() const {
+    Mat<T, C, R> t;
+    for(int i = 0; i < R; i++)
+      for(int j = 0; j < C; j++)
+	t[j][i] = row[i][j];
+    return t;
+  }
+  Mat inv() const;
+
+  // (outX[i], outY[i]) = M (xs[i], ys[i], 1) divided by its third
+  // component for the n points, or with the bottom row taken to be
+  // (0, 0, 1) unless projective. 3 x 3 only, the outputs may be the
+  // inputs. Evaluated in float for a float matrix and float points,
+  // in double otherwise.
+  void transformPoints(const float *xs, const float *ys, float *outX, float *outY, size_t n,
+		       bool projective) const;
+  void transformPoints(const double *xs, const double *ys, double *outX, double *outY, size_t n,
+		       bool projective) const;
+
+  friend Mat operator+(const Mat &a, const Mat &b) {
+    Mat r;
+    for(int i = 0; i < R; i++)
+      r.row[i] = a.row[i] + b.row[i];
+    return r;
+  }
+  friend Mat operator-(const Mat &a, const Mat &b) {
+    Mat r;
+    for(int i = 0; i < R; i++)
+      r.row[i] = a.row[i] - b.row[i];
+    return r;
+  }
+  friend Mat operator*(T s, const Mat &a) {
+    Mat r;
+    for(int i = 0; i < R; i++)
+      r.row[i] = s * a.row[i];
+    return r;
+  }
+  friend Mat operator*(const Mat &a, T s) {
+    return s * a;
+  }
+  friend ostream& operator<<(ostream &os, const Mat &a) {
+    for(int i = 0; i < R; i++){
+      for(int j = 0; j < C; j++)
+	os << setw(7) << setprecision(3) << Round(a.row[i][j], 3) << " ";
+      os << endl;
+    }
+    return os;
+  }
+};
+
+// matrix product
+template <typename T, int R, int K, int C>
+inline Mat<T, R, C> operator*(const Mat<T, R, K> &a, const Mat<T, K, C> &b)
+{
+  Mat<T, R, C> result;
+  for(int i = 0; i < R; i++)
+    for(int j = 0; j < C; j++){
+      T sum = 0;
+      for(int k = 0; k < K; k++)
+	sum += a[i][k] * b[k][j];
+      result[i][j] = sum;
+    }
+  return result;
+}
+
+// mat times vector
+template <typename T, int R, int C>
+inline Vec<T, R> operator*(const Mat<T, R, C> &m, const Vec<T, C> &v)
+{
+  Vec<T, R> result;
+  for(int i = 0; i < R; i++){
+    T sum = 0;
+    for(int j = 0; j < C; j++)
+      sum += m[i][j] * v[j];
+    result[i] = sum;
+  }
+  return result;
+}
+
+// vector times mat
+template <typename T, int R, int C>
+inline Vec<T, C> operator*(const Vec<T, R> &v, const Mat<T, R, C> &m)
+{
+  Vec<T, C> result;
+  for(int j = 0; j < C; j++){
+    T sum = 0;
+    for(int i = 0; i < R; i++)
+      sum += v[i] * m[i][j];
+    result[j] = sum;
+  }
+  return result;
+}
+
+// outer product of v1, v2 (i.e. v1 times v2 transpose)
+template <typename T, int N>
+inline Mat<T, N, N> operator&(const Vec<T, N> &a, const Vec<T, N> &b)
+{
+  Mat<T, N, N> product;
+  for(int i = 0; i < N; i++)
+    for(int j = 0; j < N; j++)
+      product[i][j] = a[i] * b[j];
+  return product;
+}
+
+namespace vecmat {
+
+// vectorized where the CPU allows, the coefficients m are row-major
+void transformPoints(const float *m, const float *xs, const float *ys, float *outX, float *outY, size_t n,
+		     bool projective);
+void transformPoints(const double *m, const float *xs, const float *ys, float *outX, float *outY, size_t n,
+		     bool projective);
+void transformPoints(const double *m, const double *xs, const double *ys, double *outX, double *outY,
+		     size_t n, bool projective);
+
+// closed forms for 2 x 2 and 3 x 3, LU decomposition from Numerical Recipes above that
+template <typename T>
+Mat<T, 2, 2> inverse(const Mat<T, 2, 2> &m)
+{
+  T d = m[0][0]*m[1][1] - m[0][1]*m[1][0];
+
+  if(d == 0)
+    cerr << "inverse of singular Matrix2x2" << endl;
+
+  return Mat<T, 2, 2>(m[1][1] / d, -m[0][1] / d,
+		      -m[1][0] / d, m[0][0] / d);
+}
+
+template <typename T>
+Mat<T, 3, 3> inverse(const Mat<T, 3, 3> &m)
+{
+  T d = m[0][0]*m[1][1]*m[2][2] + m[0][1]*m[1][2]*m[2][0] +
+    m[0][2]*m[2][1]*m[1][0] - m[0][2]*m[1][1]*m[2][0] -
+    m[0][1]*m[1][0]*m[2][2] - m[0][0]*m[2][1]*m[1][2];
+
+  if(d == 0)
+    cerr << "inverse of singular Matrix3x3" << endl;
+
+  return Mat<T, 3, 3>((m[1][1]*m[2][2] - m[1][2]*m[2][1]) / d,
+		      (m[0][2]*m[2][1] - m[0][1]*m[2][2]) / d,
+		      (m[0][1]*m[1][2] - m[0][2]*m[1][1]) / d,
+		      (m[1][2]*m[2][0] - m[1][0]*m[2][2]) / d,
+		      (m[0][0]*m[2][2] - m[0][2]*m[2][0]) / d,
+		      (m[0][2]*m[1][0] - m[0][0]*m[1][2]) / d,
+		      (m[1][0]*m[2][1] - m[1][1]*m[2][0]) / d,
+		      (m[0][1]*m[2][0] - m[0][0]*m[2][1]) / d,
+		      (m[0][0]*m[1][1] - m[0][1]*m[1][0]) / d);
+}
+
+template <typename T, int N>
+Mat<T, N, N> luDecompose(const Mat<T, N, N> &M, int *indx)
+{
+  int i, imax = 0, j, k;
+  T big, dum, sum, temp;
+  T vv[N];
+  Mat<T, N, N> LU_M = M;
+
+  for(i = 0; i < N; i++){
+    big = 0;
+    for(j = 0; j < N; j++)
+      if((temp = Abs(M[i][j])) > big)
+	big = temp;
+    if(big == 0)
+      cerr << "inverse of singular Matrix" << N << "x" << N << endl;
+
+    vv[i] = 1 / big;
+  }
+
+  for(j = 0; j < N; j++){
+    for(i = 0; i < j; i++){
+      sum = LU_M[i][j];
+      for(k = 0; k < i; k++)
+	sum -= LU_M[i][k] * LU_M[k][j];
+      LU_M[i][j] = sum;
+    }
+    big = 0;
+    for(i = j; i < N; i++){
+      sum = LU_M[i][j];
+      for(k = 0; k < j; k++)
+	sum -= LU_M[i][k] * LU_M[k][j];
+      LU_M[i][j] = sum;
+      if((dum = vv[i]*Abs(sum)) >= big){
+	big = dum;
+	imax = i;
+      }
+    }
+    if(j != imax){
+      for(k = 0; k < N; k++){
+	dum = LU_M[imax][k];
+	LU_M[imax][k] = LU_M[j][k];
+	LU_M[j][k] = dum;
+      }
+      vv[imax] = vv[j];
+    }
+    indx[j] = imax;
+    if(j < N - 1){
+      dum = 1 / LU_M[j][j];
+      for(i = j + 1; i < N; i++)
+	LU_M[i][j] *= dum;
+    }
+  }
+
+  return LU_M;
+}
+
+template <typename T, int N>
+void luBackSubstitution(const Mat<T, N, N> &M, const int *indx, T col[])
+{
+  int i, ii = -1, ip, j;
+  T sum;
+
+  for(i = 0; i < N; i++){
+    ip = indx[i];
+    sum = col[ip];
+    col[ip] = col[i];
+    if(ii >= 0)
+      for(j = ii; j < i; j++)
+	sum -= M[i][j] * col[j];
+    else if(sum)
+      ii = i;
+    col[i] = sum;
+  }
+
+  for(i = N - 1; i >= 0; i--){
+    sum = col[i];
+    for(j = i + 1; j < N; j++)
+      sum -= M[i][j] * col[j];
+    col[i] = sum / M[i][i];
+  }
+}
+
+template <typename T, int N>
+Mat<T, N, N> inverse(const Mat<T, N, N> &m)
+{
+  Mat<T, N, N> LU_M, invM;
+  int i, j, indx[N];
+  T col[N];
+
+  LU_M = luDecompose(m, indx);
+
+  for(j = 0; j < N; j++){
+    for(i = 0; i < N; i++)
+      col[i] = 0;
+    col[j] = 1;
+    luBackSubstitution(LU_M, indx, col);
+    for(i = 0; i < N; i++)
+      invM[i][j] = col[i];
+  }
+
+  return invM;
+}
+
+}
+
+template <typename T, int R, int C>
+inline Mat<T, R, C> Mat<T, R, C>::inv() const
+{
+  static_assert(R == C, "cannot invert a non-square matrix");
+  return vecmat::inverse(*this);
+}
+
+template <typename T, int R, int C>
+inline void Mat<T, R, C>::transformPoints(const float *xs, const float *ys, float *outX, float *outY,
+					  size_t n, bool projective) const
+{
+  static_assert(R == 3 && C == 3, "points are transformed by 3 x 3 matrices");
+  typedef typename std::conditional<std::is_same<T, float>::value, float, double>::type U;
+  const U m[9] = {U(row[0][0]), U(row[0][1]), U(row[0][2]),
+		  U(row[1][0]), U(row[1][1]), U(row[1][2]),
+		  U(row[2][0]), U(row[2][1]), U(row[2][2])};
+  vecmat::transformPoints(m, xs, ys, outX, outY, n, projective);
+}
+
+template <typename T, int R, int C>
+inline void Mat<T, R, C>::transformPoints(const double *xs, const double *ys, double *outX, double *outY,
+					  size_t n, bool projective) const
+{
+  static_assert(R == 3 && C == 3, "points are transformed by 3 x 3 matrices");
+  const double m[9] = {double(row[0][0]), double(row[0][1]), double(row[0][2]),
+		       double(row[1][0]), double(row[1][1]), double(row[1][2]),
+		       double(row[2][0]), double(row[2][1]), double(row[2][2])};
+  vecmat::transformPoints(m, xs, ys, outX, outY, n, projective);
+}
+
+#endif
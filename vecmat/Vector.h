@@ -14,139 +14,68 @@
 #ifndef _H_Vector
 #define _H_Vector
 
-#include "Utility.h"
+#include "VecMat.h"
 using namespace std;
 
 /* Vector Descriptions and Operations */
 
-class Vector2d;
-class Vector3d;
-class Vector4d;
+// fixed size vectors, see VecMat.h
+typedef Vec<double, 2> Vector2d;
+typedef Vec<double, 3> Vector3d;
+typedef Vec<double, 4> Vector4d;
+typedef Vec<float, 2> Vector2f;
+typedef Vec<float, 3> Vector3f;
+typedef Vec<float, 4> Vector4f;
+
+//
+// Sums, differences and scalar multiples of Vectors, and products with
+// Matrices, are expressions: nothing is computed until the expression is
+// assigned to a Vector, which then fills in every component in a single
+// loop without intermediate vectors. Expressions refer to their operands,
+// so they must be assigned in the statement that builds them.
+//
+// An expression E provides getn(), the component at(i), and aliases(p),
+// true if a component depends on other components of the object at p,
+// which therefore cannot be assigned the result in place. The methods
+// below evaluate the expression first, so (v1 + v2).norm() works.
+//
 class Vector;
 
-class Vector2d {
+template <typename E>
+class VectorExpression {
 public:
-  double x, y;
-
-  Vector2d(double vx = 0, double vy = 0);
-  Vector2d(const Vector2d &v);
-
-  double& operator[](int i);
-  const double& operator[](int i) const;
-
-  operator Vector3d();
-  operator Vector4d();
-  operator Vector();
-
-  void print() const;
-  void print(int w, int p) const;	// print with width and precision
-
-  double norm() const;			// magnitude of vector
-  double normsqr() const;		// magnitude squared
-  Vector2d normalize() const;		// normalize
-
-  void set(double vx = 0, double vy = 0);	// set assuming y = 0
-  void set(const Vector2d &v);
-
-  /* Vector2d operator prototypes */
-  friend Vector2d operator-(const Vector2d& v1); // unary negation of vector
-  friend Vector2d operator+(const Vector2d& v1, const Vector2d& v2);//addition 
-  friend Vector2d operator-(const Vector2d& v1, const Vector2d& v2);//subtract
-  friend Vector2d operator*(const Vector2d& v, double s); // scalar mult
-  friend Vector2d operator*(double s, const Vector2d& v);
-  friend double   operator*(const Vector2d& v1, const Vector2d& v2); // dot
-  friend Vector2d operator^(const Vector2d& v1, const Vector2d& v2); //compt *
-  friend Vector3d operator%(const Vector2d& v1, const Vector2d& v2); // cross
-  friend Vector2d operator/(const Vector2d& v, double s); // division by scalar
-  friend short    operator==(const Vector2d& one, const Vector2d& two); // eq
-  friend ostream& operator<< (ostream& os, const Vector2d& v);
-};
-
-class Vector3d {
-public:
-  double x, y, z;
-
-  Vector3d(double vx = 0, double vy = 0, double vz = 0);
-  Vector3d(const Vector3d &v);
-
-  double& operator[](int i);
-  const double& operator[](int i) const;
-
-  operator Vector4d();
-  operator Vector();
+  const E& self() const { return static_cast<const E&>(*this); }
 
+  Vector eval() const;
+  double operator[](int i) const;
+  double norm() const;
+  double normsqr() const;
+  Vector normalize() const;
   void print() const;
-  void print(int w, int p) const;	// print with width and precision
-
-  double norm() const;			// magnitude of vector
-  double normsqr() const;		// magnitude squared
-  Vector3d normalize() const;		// normalize
-
-  void set(double vx = 0, double vy = 0, double vz = 0); // set
-  void set(const Vector3d &v);
-
-  /* Vector3d operator prototypes */
-  friend Vector3d operator-(const Vector3d& v1);	// unary negation
-  Vector3d operator+(const Vector3d& v2) const; // vector addition 
-  friend Vector3d operator-(const Vector3d& v1, const Vector3d& v2); // subtract
-  friend Vector3d operator*(const Vector3d& v, double s);      // multiply
-  friend Vector3d operator*(double s, const Vector3d& v);
-  friend double   operator*(const Vector3d& v1, const Vector3d& v2); // dot
-  friend Vector3d operator^(const Vector3d& v1, const Vector3d& v2); // compt *
-  friend Vector3d operator%(const Vector3d& v1, const Vector3d& v2); // cross
-  friend Vector3d operator/(const Vector3d& v, double s); // division by scalar
-  friend short    operator==(const Vector3d& one, const Vector3d& two); // equ
-  friend ostream& operator<< (ostream& os, const Vector3d& v);
 };
 
-class Vector4d {
-public:
-  double x, y, z, w;
-
-  Vector4d(double vx = 0, double vy = 0, double vz = 0, double vw = 0);
-  Vector4d(const Vector4d &v);
+// vectors of up to this many components are stored in place
+#define VECTOR_LOCAL_SIZE	4
 
-  double& operator[](int i);
-  const double& operator[](int i) const;
-  
-  operator Vector();
-
-  void print() const;
-  void print(int w, int p) const;	// print with width and precision
-
-  double norm() const;			// magnitude of vector
-  double normsqr() const;		// magnitude squared
-  Vector4d normalize() const;		// normalize
-  Vector4d wnorm() const;		// normalize to w coord.
-
-  void set(double vx = 0, double vy = 0, double vz = 0, double vw = 0); // set
-  void set(const Vector4d &v);
-
-  /* Vector4d operator prototypes */
-  friend Vector4d operator-(const Vector4d& v1);  // unary negation
-  Vector4d operator+(const Vector4d& v2) const; // vector addition 
-  friend Vector4d operator-(const Vector4d& v1, const Vector4d& v2); //subtract
-  friend Vector4d operator*(const Vector4d& v, double s);	// multiply
-  friend Vector4d operator*(double s, const Vector4d& v);
-  friend double   operator*(const Vector4d& v1, const Vector4d& v2); // dot
-  friend Vector4d operator^(const Vector4d& v1, const Vector4d& v2); // compt *
-  friend Vector4d operator%(const Vector4d& v1, const Vector4d& v2); // cross
-  friend Vector4d operator/(const Vector4d& v, double s); // divide by scalar
-  friend short    operator==(const Vector4d& one, const Vector4d& two); // equ
-  friend ostream& operator<< (ostream& os, const Vector4d& v);
-};
-
-class Vector {
+class Vector : public VectorExpression<Vector> {
 protected:
   int N;
-  double *v;
+  double *v;				// local, or allocated if N is larger
+  double local[VECTOR_LOCAL_SIZE];
+
+  void allocate(int vN);		// v for N = vN, not initialized
+  void release();			// back to an empty vector
+  void take(Vector& V);			// storage of V, leaving V empty
 
 public:
   Vector(int vN = 0, double *vx = NULL);
   Vector(const Vector& V);
+  Vector(Vector&& V);
   Vector(double vx, double vy);
   Vector(double vx, double vy, double vz);
   Vector(double vx, double vy, double vz, double vw);
+  template <int M> Vector(const Vec<double, M>& V);
+  template <typename E> Vector(const VectorExpression<E>& e);
 
   ~Vector();
 
@@ -155,11 +84,11 @@ public:
   double& operator[](int i);
   const double& operator[](int i) const;  
 
-  operator Vector2d();
-  operator Vector3d();
-  operator Vector4d();
+  template <int M> operator Vec<double, M>() const;
 
-  int getn() const;
+  int getn() const { return N; }
+  double at(int i) const { return v[i]; }		// unchecked
+  bool aliases(const void *) const { return false; }
 
   void print() const;
   void print(int w, int p) const;	// print with width and precision
@@ -176,11 +105,8 @@ public:
 
   /* Vector operator prototypes */
   const Vector& operator=(const Vector& v2);		// assignment
-  friend Vector operator-(const Vector& v1);		// unary negation
-  friend Vector operator+(const Vector& v1, const Vector& v2); // vector add
-  friend Vector operator-(const Vector& v1, const Vector& v2); // vector sub
-  friend Vector operator*(const Vector& v, double s);       // scalar multiply
-  friend Vector operator*(double s, const Vector& v);
+  const Vector& operator=(Vector&& v2);
+  template <typename E> const Vector& operator=(const VectorExpression<E>& e);
   friend Vector operator^(const Vector& v1, const Vector& v2); // component *
   friend double operator*(const Vector& v1, const Vector& v2); // dot product 
   friend Vector operator%(const Vector& v1, const Vector& v2); // cross product
@@ -189,4 +115,175 @@ public:
   friend ostream& operator<< (ostream& os, const Vector& v);
 };
 
+template <int M>
+Vector::Vector(const Vec<double, M>& V) : N(0), v(local){
+  allocate(M);
+  for(int i = 0; i < M; i++)
+    v[i] = V[i];
+}
+
+template <typename E>
+Vector::Vector(const VectorExpression<E>& e) : N(0), v(local){
+  *this = e;
+}
+
+template <typename E>
+const Vector& Vector::operator=(const VectorExpression<E>& e){
+  const E& x = e.self();
+  if(x.aliases(this))
+    return *this = Vector(x);
+
+  if(N != x.getn()){
+    release();
+    allocate(x.getn());
+  }
+  for(int i = 0; i < N; i++)
+    v[i] = x.at(i);
+  return *this;
+}
+
+// missing components are 0
+template <int M>
+Vector::operator Vec<double, M>() const{
+  if(N > M){
+    cerr << "cannot convert " << N << " Vector to " << M << "d Vector" << endl;
+    exit(1);
+  }
+
+  Vec<double, M> rv;
+  for(int i = 0; i < N; i++)
+    rv[i] = v[i];
+  return rv;
+}
+
+/* Vector expressions */
+
+template <typename E>
+inline Vector VectorExpression<E>::eval() const{
+  return Vector(*this);
+}
+
+template <typename E>
+inline double VectorExpression<E>::operator[](int i) const{
+  if(i < 0 || i >= self().getn()){
+    cerr << self().getn() << " vector index bounds error" << endl;
+    exit(1);
+  }
+  return self().at(i);
+}
+
+template <typename E>
+inline double VectorExpression<E>::norm() const{
+  return eval().norm();
+}
+
+template <typename E>
+inline double VectorExpression<E>::normsqr() const{
+  return eval().normsqr();
+}
+
+template <typename E>
+inline Vector VectorExpression<E>::normalize() const{
+  return eval().normalize();
+}
+
+template <typename E>
+inline void VectorExpression<E>::print() const{
+  eval().print();
+}
+
+template <typename E>
+inline ostream& operator<< (ostream& os, const VectorExpression<E>& e){
+  return os << e.eval();
+}
+
+template <typename A, typename B>
+class VectorSum : public VectorExpression<VectorSum<A, B> > {
+  const A& a;
+  const B& b;
+
+public:
+  VectorSum(const A& a, const B& b) : a(a), b(b){
+    if(a.getn() != b.getn()){
+      cerr << "cannot add " << a.getn() << " Vector to " << b.getn() << " Vector" << endl;
+      exit(1);
+    }
+  }
+
+  int getn() const { return a.getn(); }
+  double at(int i) const { return a.at(i) + b.at(i); }
+  bool aliases(const void *p) const { return a.aliases(p) || b.aliases(p); }
+};
+
+template <typename A, typename B>
+class VectorDifference : public VectorExpression<VectorDifference<A, B> > {
+  const A& a;
+  const B& b;
+
+public:
+  VectorDifference(const A& a, const B& b) : a(a), b(b){
+    if(a.getn() != b.getn()){
+      cerr << "cannot subtract " << b.getn() << " Vector from " << a.getn() << " Vector" << endl;
+      exit(1);
+    }
+  }
+
+  int getn() const { return a.getn(); }
+  double at(int i) const { return a.at(i) - b.at(i); }
+  bool aliases(const void *p) const { return a.aliases(p) || b.aliases(p); }
+};
+
+template <typename A>
+class VectorScale : public VectorExpression<VectorScale<A> > {
+  const A& a;
+  double s;
+
+public:
+  VectorScale(const A& a, double s) : a(a), s(s) {}
+
+  int getn() const { return a.getn(); }
+  double at(int i) const { return s * a.at(i); }
+  bool aliases(const void *p) const { return a.aliases(p); }
+};
+
+template <typename A, typename B>
+inline VectorSum<A, B> operator+(const VectorExpression<A>& a, const VectorExpression<B>& b){
+  return VectorSum<A, B>(a.self(), b.self());
+}
+
+template <typename A, typename B>
+inline VectorDifference<A, B> operator-(const VectorExpression<A>& a, const VectorExpression<B>& b){
+  return VectorDifference<A, B>(a.self(), b.self());
+}
+
+template <typename A>
+inline VectorScale<A> operator-(const VectorExpression<A>& a){	// unary negation
+  return VectorScale<A>(a.self(), -1);
+}
+
+template <typename A>
+inline VectorScale<A> operator*(double s, const VectorExpression<A>& a){
+  return VectorScale<A>(a.self(), s);
+}
+
+template <typename A>
+inline VectorScale<A> operator*(const VectorExpression<A>& a, double s){
+  return VectorScale<A>(a.self(), s);
+}
+
+// exact matches for a Vector, where the dot product would otherwise compete
+// by converting the number through Vector(int)
+inline VectorScale<Vector> operator*(double s, const Vector& a){
+  return VectorScale<Vector>(a, s);
+}
+
+inline VectorScale<Vector> operator*(const Vector& a, double s){
+  return VectorScale<Vector>(a, s);
+}
+
+// operand of a product, which reads each component many times: Vectors
+// are used where they are, anything else is evaluated once
+template <typename E> struct VectorOperand { typedef Vector type; };
+template <> struct VectorOperand<Vector> { typedef const Vector& type; };
+
 #endif
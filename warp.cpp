@@ -1,35 +1,68 @@
 #include <iostream>
 #include "vecmat/Vector.h"
 #include "vecmat/Matrix.h"
+#include "warp/pixel.h"
+#include "warp/image.h"
+#include "warp/kernels.h"
+#include "warp/plan.h"
+#include "warp/sourcecache.h"
+#include "warp/pipeline.h"
+#include "warp/stats.h"
 #include <sstream>
+#include <fstream>
+#include <algorithm>
 #include <vector>
+#include <future>
+#include <thread>
+#include <atomic>
 #include <OpenImageIO/imageio.h>
 
-#ifdef __APPLE__
-#  include <GLUT/glut.h>
-#else
-#  include <GL/glut.h>
+#ifndef WARP_HEADLESS
+#  ifdef __APPLE__
+#    include <GLUT/glut.h>
+#  else
+#    include <GL/glut.h>
+#  endif
 #endif
 
 using namespace std;
 OIIO_NAMESPACE_USING
 
 
-// Struct Declaration
-struct pixel {
-    float r, g, b, a;
-};
-
-
 // Global Variable Declarations
 int IMAGE_HEIGHT;
 int IMAGE_WIDTH;
 int NEW_IMAGE_HEIGHT;
 int NEW_IMAGE_WIDTH;
 Matrix3x3 TRANSFORM_MATRIX(1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0);
-char * OUTPUT_FILENAME;
-pixel ** TRANSFORMED_PIXMAP;
-Vector3d TRANSFORMED_ORIGIN(0.0, 0.0, 0.0);
+char * INPUT_FILENAME = NULL;
+char * OUTPUT_FILENAME = NULL;
+Image TRANSFORMED_IMAGE;
+ImageLayout IMAGE_LAYOUT = LAYOUT_INTERLEAVED;
+bool NATIVE_FORMAT = true;             // samples are kept in the type of the input file
+PixelFormat IMAGE_FORMAT = FORMAT_FLOAT; // sample type of the source and the output, per image unless forced
+shared_ptr<const WarpPlan> WARP_PLAN; // of TRANSFORM_MATRIX for the current source
+WarpPlanCache PLAN_CACHE;       // images of a batch with the same size and format share their plan
+WarpKernel WARP_KERNEL = WARP_KERNEL_AUTO;
+int WARP_THREADS = 0; // 0 = one thread per hardware thread
+SimdIsa WARP_ISA = SIMD_ISA_SCALAR;
+WarpFilter WARP_FILTER = FILTER_NEAREST;
+EdgeMode WARP_EDGE = EDGE_BLACK;
+MinifyMode WARP_MINIFY = MINIFY_NONE;
+MipPyramid * SOURCE_MIPMAP = NULL;
+bool STREAM_OUTPUT = false;
+double MEMORY_BUDGET_MB = 0.0; // 0 = the source is read into memory as a whole
+string TRANSFORM_SCRIPT;       // batch mode when not empty, the commands are not read from stdin
+char * BATCH_FILENAME = NULL;
+int PIPELINE_DEPTH = 1;        // images queued between the read, warp and write stages of a batch, 0 = no overlap
+SourceCache * SOURCE_CACHE = NULL;
+StatsFormat STATS_FORMAT = STATS_OFF; // time and memory per stage, printed to stderr at the end
+#ifdef WARP_HEADLESS
+bool HEADLESS = true;          // no window, the warped image is only written
+#else
+bool HEADLESS = false;
+#endif
+const StageTimer::Clock::time_point PROGRAM_START = StageTimer::Clock::now();
 
 
 /* Handles errors
@@ -40,131 +73,148 @@ Vector3d TRANSFORMED_ORIGIN(0.0, 0.0, 0.0);
 void handleError (string message, bool kill) {
     cout << "ERROR: " << message << "\n";
     if (kill)
-        exit(0);
+        exit(1);
 }
 
 
-/*
-    Initializes a pixmap and sets it up for double array syntax for accessing elements
+/* Prints the seconds from the start of the program until the first output pixels were written or displayed
+ * input	- where the pixels went
+ * output	- None
+ * side effect - prints on the first call only, from whichever thread gets there first
  */
-void initializePixmap(pixel ** &pixmap, int image_width, int image_height) {
-    pixmap = new pixel*[image_height];
-    pixmap[0] = new pixel[image_width * image_height];
-
-    for (int i = 1; i < image_height; i++)
-        pixmap[i] = pixmap[i - 1] + image_width;
+void reportFirstPixel (const char * where) {
+    static atomic<bool> reported(false);
+    if (reported.exchange(true))
+        return;
+    double seconds = chrono::duration<double>(StageTimer::Clock::now() - PROGRAM_START).count();
+    cout << "Startup to first pixel " << where << ": " << seconds << " s\n";
 }
 
 
-/*
-    Flips image verticaly
- */
-void flipImageVertical(float *&pixmap_vertical_flip, int height, int width, int channels) {
-    pixel ** temp_pixmap;
-    initializePixmap(temp_pixmap, IMAGE_WIDTH, IMAGE_HEIGHT);
-
-    int i = 0;
-    for (int row = height-1; row >= 0; row--)
-        for (int col = 0; col < width; col++) {
-            temp_pixmap[row][col].r = pixmap_vertical_flip[i++];
-            temp_pixmap[row][col].g = pixmap_vertical_flip[i++];
-            temp_pixmap[row][col].b = pixmap_vertical_flip[i++];
-            temp_pixmap[row][col].a = pixmap_vertical_flip[i++];
-        }
+/* Reads image specified in argv[1]
+ * input		- the input file name, error message
+ * output		- the image in IMAGE_LAYOUT, in IMAGE_FORMAT or the sample type of the file if it is native,
+ *				  an empty image with the reason in error if it cannot be read
+ *
+ * Sets no globals and never ends the program, the reader thread of a batch runs it while the previous
+ * image is warped.
+ */
+Image readImage (string filename, string &error) {
+    ScopedStage stage("read");
+    ImageInput *in = ImageInput::open(filename);
+    if (!in) {
+        error = "Could not open input file " + filename;
+        return Image();
+    }
+    const ImageSpec &spec = in->spec();
+    const int width = spec.width;
+    const int height = spec.height;
+    int channels = spec.nchannels;
+    if(channels < 3 || channels > 4) {
+        error = "Application supports 3 or 4 channel images only";
+        delete in;
+        return Image();
+    }
+    if(spec.depth > 1) {
+        error = "Application supports 2D images only";
+        delete in;
+        return Image();
+    }
 
-    i = 0;
-    for (int row = 0; row < height; row++)
-        for (int col = 0; col < width; col++) {
-            pixmap_vertical_flip[i++] = temp_pixmap[row][col].r;
-            pixmap_vertical_flip[i++] = temp_pixmap[row][col].g;
-            pixmap_vertical_flip[i++] = temp_pixmap[row][col].b;
-            pixmap_vertical_flip[i++] = temp_pixmap[row][col].a;
+    const PixelFormat format = NATIVE_FORMAT ? nativePixelFormat(spec.format) : IMAGE_FORMAT;
+
+    // OIIO writes straight into an interleaved image: every file pixel lands at the start of a
+    // four sample pixel, and the flipped view stores the first scanline in the last row. Planar
+    // and tiled images are read a scanline at a time and scattered into the planes or blocks.
+    // Scanlines are numbered from the data window origin spec.y, in the slice spec.z, and each
+    // one starts at column spec.x of the file, which is column 0 of the image.
+    Image image(width, height, IMAGE_LAYOUT, format);
+    const TypeDesc type = pixelFormatType(format);
+    const int size = pixelFormatSize(format);
+    bool read = true;
+    if (IMAGE_LAYOUT != LAYOUT_INTERLEAVED) {
+        ImageView pixels = image.view();
+        vector<unsigned char> scanline((size_t) width * 4 * size);
+        for (int row = 0; row < height and read; row++) {
+            read = in->read_scanlines (spec.y + row, spec.y + row + 1, spec.z, 0, channels, type, &scanline[0],
+                                       4 * size);
+            for (int col = 0; col < width; col++)
+                for (int channel = 0; channel < channels; channel++)
+                    memcpy(pixels.sample(channel, col, height - 1 - row),
+                           &scanline[((size_t) col * 4 + channel) * size], size);
         }
-
-    delete temp_pixmap;
-}
-
-
-/* Converts pixels from vector to pixel pointers
- * input		- vector of pixels, number of channels
- * output		- None
- * side effect	- saves pixel data from vector to PIXMAP
- */
-pixel ** convertVectorToImage (vector<float> vector_pixels, int channels) {
-    pixel ** image;
-    initializePixmap(image, IMAGE_WIDTH, IMAGE_HEIGHT);
-
-    int i = 0;
-    if (channels == 3) {
-        for (int row = IMAGE_HEIGHT-1; row >= 0; row--)
-            for (int col = 0; col < IMAGE_WIDTH; col++) {
-                image[row][col].r = vector_pixels[i++];
-                image[row][col].g = vector_pixels[i++];
-                image[row][col].b = vector_pixels[i++];
-                image[row][col].a = 1.0;
-            }
     }
-    else if (channels == 4) {
-        for (int row = IMAGE_HEIGHT-1; row >= 0; row--)
-            for (int col = 0; col < IMAGE_HEIGHT; col++) {
-                image[row][col].r = vector_pixels[i++];
-                image[row][col].g = vector_pixels[i++];
-                image[row][col].b = vector_pixels[i++];
-                image[row][col].a = vector_pixels[i++];
-            }
+    else {
+        ImageView file_rows = image.view().flipped();
+        read = in->read_image (type, file_rows.data, 4 * size, file_rows.row_stride);
     }
-    else
-        handleError ("Could not convert image.. sorry", 1);
+    if (!read)
+        error = "Could not read input file: " + in->geterror();
+    in->close ();
+    delete in;
+    if (!read)
+        return Image();
+
+    if (channels == 3)
+        setOpaque(image.view());
 
     return image;
 }
 
 
-/* Reads image specified in argv[1]
- * input		- the input file name
- * output		- None
+/* Writes scanlines file_row .. file_row_end - 1 of an open output file
+ * input		- output file, rows in file order, row 0 of rows is scanline file_row
+ * output		- false if writing failed
+ *
+ * Interleaved rows go to OIIO as they are, planar rows are interleaved a scanline at a time.
+ * The samples are handed over in their own type, OIIO converts them if the file needs another.
  */
-pixel ** readImage (string filename) {
-    ImageInput *in = ImageInput::open(filename);
-    if (!in)
-        handleError("Could not open input file", true);
-    const ImageSpec &spec = in->spec();
-    IMAGE_WIDTH = spec.width;
-    IMAGE_HEIGHT = spec.height;
-    int channels = spec.nchannels;
-    if(channels < 3 || channels > 4)
-        handleError("Application supports 3 or 4 channel images only", 1);
-    vector<float> pixels (IMAGE_WIDTH*IMAGE_HEIGHT*channels);
-    in->read_image (TypeDesc::FLOAT, &pixels[0]);
-    in->close ();
-    delete in;
-
-
-    return convertVectorToImage(pixels, channels);
+bool writeScanlines (ImageOutput *out, const ImageView &rows, int file_row, int file_row_end) {
+    const TypeDesc type = pixelFormatType(rows.format);
+    const int size = pixelFormatSize(rows.format);
+    if (rows.layout == LAYOUT_INTERLEAVED)
+        return out->write_scanlines (file_row, file_row_end, 0, type, rows.data, 4 * size, rows.row_stride);
+
+    vector<unsigned char> scanline((size_t) rows.width * 4 * size);
+    for (int row = file_row; row < file_row_end; row++) {
+        for (int col = 0; col < rows.width; col++)
+            for (int channel = 0; channel < 4; channel++)
+                memcpy(&scanline[((size_t) col * 4 + channel) * size], rows.sample(channel, col, row - file_row), size);
+        if (!out->write_scanlines (row, row + 1, 0, type, &scanline[0]))
+            return false;
+    }
+    return true;
 }
 
 
 /* Write image to specified file
- * input		- pixel array, width of display window, height of display window
- * output		- None
+ * input		- the image, output file name, error message
+ * output		- false with the reason in error if the file could not be written
  * side effect	- writes image to a file
+ *
+ * Never ends the program, the writer thread of a batch runs it while the next image is warped.
  */
-void writeImage (pixel ** &pixmap, char * output_file_name, int window_width, int window_height) {
+bool writeImage (const Image &image, const char * output_file_name, string &error) {
+    ScopedStage stage("write");
     const char *filename = output_file_name;
-    const int xres = window_width, yres = window_height;
     const int channels = 4; // RGBA
-    int scanlinesize = xres * channels;
     ImageOutput *out = ImageOutput::create (filename);
     if (! out) {
-        handleError("Could not create output file", false);
-        return;
+        error = string("Could not create output file ") + filename;
+        return false;
     }
-    ImageSpec spec (xres, yres, channels, TypeDesc::FLOAT);
-    out->open (filename, spec);
-    out->write_image (TypeDesc::FLOAT, pixmap);
+    ImageSpec spec (image.width(), image.height(), channels, pixelFormatType(image.format()));
+    // the image is stored bottom up, the flipped view starts at its last row and walks backwards
+    bool written = out->open (filename, spec) and writeScanlines (out, image.view().flipped(), 0, image.height());
+    if (!written)
+        error = "Could not write output file: " + out->geterror();
     out->close ();
     delete out;
+    if (!written)
+        return false;
     cout << "SUCCESS: Image successfully written to " << output_file_name << "\n";
+    reportFirstPixel("written");
+    return true;
 }
 
 
@@ -280,9 +330,10 @@ void calculatePerspectiveTransform(double x_perspective, double y_perspective) {
 
 
 /*
-    Control logic for different input strings
+    Control logic for different input strings, returns false for unknown or incomplete commands
  */
-void calculateTransformMatrix(string user_input) {
+bool calculateTransformMatrix(string user_input) {
+    ScopedStage stage("parse");
     double theta;
     double x_scale, y_scale;
     double x_translate, y_translate;
@@ -294,137 +345,255 @@ void calculateTransformMatrix(string user_input) {
 
     if (user_input.compare(0, 1, "r") == 0) {
         string_stream >> temp >> theta;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nRotation applied. ENTER next command (ENTER d when finished):\n";
         calculateRotationTransform(theta);
     }
     else if (user_input.compare(0, 1, "s") == 0) {
         string_stream >> temp >> x_scale >> y_scale;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nScale applied. ENTER next command (ENTER d when finished):\n";
         calculateScaleTransform(x_scale, y_scale);
     }
     else if (user_input.compare(0, 1, "t") == 0) {
         string_stream >> temp >> x_translate >> y_translate;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nTranslate applied. ENTER next command (ENTER d when finished):\n";
         calculateTranslateTransform(x_translate, y_translate);
     }
     else if (user_input.compare(0, 1, "f") == 0) {
         string_stream >> temp >> x_flip >> y_flip;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nFlip applied. ENTER next command (ENTER d when finished):\n";
         calculateFlipTransform(x_flip, y_flip);
     }
     else if (user_input.compare(0, 1, "h") == 0) {
         string_stream >> temp >> x_shear >> y_shear;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nShear applied. ENTER next command (ENTER d when finished):\n";
         calculateShearTransform(x_shear, y_shear);
     }
     else if (user_input.compare(0, 1, "p") == 0) {
         string_stream >> temp >> x_perspective >> y_perspective;
+        if (string_stream.fail())
+            return false;
 
         cout << "\nPerspective applied. ENTER next command (ENTER d when finished):\n";
         calculatePerspectiveTransform(x_perspective, y_perspective);
     }
+    else
+        return false;
+
+    return true;
 }
 
 
-/*
-    Gets the dimensions of the new image by performing a forward map on the four corners of the original image.
-    The max and min height and width values are used to get the dimensions of the new image.
+/* The WARP_ options as the options of a plan
  */
-void getNewImageDimensions () {
-    int transformed_max_width, transformed_max_height;
-    int transformed_min_width, transformed_min_height;
+WarpOptions warpOptions() {
+    WarpOptions options;
+    options.kernel = WARP_KERNEL;
+    options.isa = WARP_ISA;
+    options.filter = WARP_FILTER;
+    options.edge = WARP_EDGE;
+    options.minify = WARP_MINIFY;
+    return options;
+}
 
-    Vector3d bottom_left_corner(0, 0, 1.0);
-    Vector3d bottom_right_corner(IMAGE_WIDTH - 1.0, 0.0, 1.0);
-    Vector3d top_left_corner(0, IMAGE_HEIGHT - 1, 1.0);
-    Vector3d top_right_corner(IMAGE_WIDTH, IMAGE_HEIGHT, 1.0);
 
-    cout << "\nCorners of transformed image\n";
-    cout << bottom_left_corner << " " << top_left_corner << " " << top_right_corner << " " << bottom_right_corner;
+/*
+    Gets the dimensions of the new image from the plan of the warp, which performs a forward map on the four
+    corners of the original image. The max and min height and width values are used to get the dimensions of the
+    new image. The plan is compiled once per source shape and reused from PLAN_CACHE. Returns false with the
+    reason in error if the warp cannot be planned.
+ */
+bool getNewImageDimensions (string &error) {
+    ScopedStage stage("dimensions");
+    WARP_PLAN = PLAN_CACHE.get(TRANSFORM_MATRIX, WarpSourceSpec(IMAGE_WIDTH, IMAGE_HEIGHT, IMAGE_LAYOUT, IMAGE_FORMAT),
+                               warpOptions());
+    if (!WARP_PLAN->valid()) {
+        error = "Could not plan the warp: " + WARP_PLAN->error();
+        return false;
+    }
 
-    // get transformed corners
-    Vector3d transformed_bottom_left_corner = TRANSFORM_MATRIX * bottom_left_corner;
-    Vector3d transformed_bottom_right_corner = TRANSFORM_MATRIX * bottom_right_corner;
-    Vector3d transformed_top_left_corner = TRANSFORM_MATRIX * top_left_corner;
-    Vector3d transformed_top_right_corner = TRANSFORM_MATRIX * top_right_corner;
+    // bottom left, top left, top right and bottom right corner
+    const double corners_x[4] = {0.0, 0.0, (double) IMAGE_WIDTH, IMAGE_WIDTH - 1.0};
+    const double corners_y[4] = {0.0, IMAGE_HEIGHT - 1.0, (double) IMAGE_HEIGHT, 0.0};
 
     cout << "\nCorners of transformed image\n";
-    cout << transformed_bottom_left_corner << " " << transformed_top_left_corner << " " << transformed_top_right_corner << " " << transformed_bottom_right_corner;
+    for (int i = 0; i < 4; i++)
+        cout << Vector3d(corners_x[i], corners_y[i], 1.0) << " ";
 
-    // normalize transformed corners
-    transformed_bottom_left_corner = transformed_bottom_left_corner / transformed_bottom_left_corner[2];
-    transformed_bottom_right_corner = transformed_bottom_right_corner / transformed_bottom_right_corner[2];
-    transformed_top_left_corner = transformed_top_left_corner / transformed_top_left_corner[2];
-    transformed_top_right_corner = transformed_top_right_corner / transformed_top_right_corner[2];
+    double transformed_x[4], transformed_y[4];
+    TRANSFORM_MATRIX.transformPoints(corners_x, corners_y, transformed_x, transformed_y, 4, true);
 
     cout << "\nCorners of transformed image after normalization\n";
-    cout << transformed_bottom_left_corner << " " << transformed_top_left_corner << " " << transformed_top_right_corner << " " << transformed_bottom_right_corner;
+    for (int i = 0; i < 4; i++)
+        cout << Vector3d(transformed_x[i], transformed_y[i], 1.0) << " ";
+
+    // the origin of the plan is the min corner
+    int transformed_min_width = (int) WARP_PLAN->origin()[0];
+    int transformed_min_height = (int) WARP_PLAN->origin()[1];
+    cout << "\ntransformed max and min height and width\n";
+    cout << transformed_min_width + WARP_PLAN->width() << " " << transformed_min_height + WARP_PLAN->height() << " "
+         << transformed_min_width << " " << transformed_min_height << "\n";
 
-    // get max and min width and height
-    transformed_max_width = (int) max(max(transformed_bottom_left_corner[0], transformed_bottom_right_corner[0]),
-                                     max(transformed_top_left_corner[0], transformed_top_right_corner[0]));
+    NEW_IMAGE_WIDTH = WARP_PLAN->width();
+    NEW_IMAGE_HEIGHT = WARP_PLAN->height();
+    return true;
+}
 
-    transformed_max_height = (int) max(max(transformed_bottom_left_corner[1], transformed_bottom_right_corner[1]),
-                                     max(transformed_top_left_corner[1], transformed_top_right_corner[1]));
 
-    transformed_min_width = (int) min(min(transformed_bottom_left_corner[0], transformed_bottom_right_corner[0]),
-                                       min(transformed_top_left_corner[0], transformed_top_right_corner[0]));
+/*
+    Storage of the warped image, tiled sources are warped into interleaved images
+ */
+ImageLayout outputLayout() {
+    return IMAGE_LAYOUT == LAYOUT_TILED ? LAYOUT_INTERLEAVED : IMAGE_LAYOUT;
+}
 
-    transformed_min_height = (int) min(min(transformed_bottom_left_corner[1], transformed_bottom_right_corner[1]),
-                                       min(transformed_top_left_corner[1], transformed_top_right_corner[1]));
-    cout << "\ntransformed max and min height and width\n";
-    cout << transformed_max_width << " " << transformed_max_height << " " << transformed_min_width << " " << transformed_min_height << "\n";
 
-    // set global transformed origin
-    TRANSFORMED_ORIGIN[0] = transformed_min_width;
-    TRANSFORMED_ORIGIN[1] = transformed_min_height;
+/*
+    Sets up the inverse map of the original image into destination
+ */
+WarpJob createWarpJob(const Image &source, const ImageView &destination) {
 
-    // calculate new image width and height
-    NEW_IMAGE_WIDTH = abs(transformed_max_width - transformed_min_width);
-    NEW_IMAGE_HEIGHT = abs(transformed_max_height - transformed_min_height);
+    cout << "\nCalculated Inverse Matrix:\n";
+    cout << WARP_PLAN->inverse();
+
+    WarpJob job = WARP_PLAN->job(source.view(), destination, SOURCE_MIPMAP);
+    if (SOURCE_CACHE) {
+        // the cache hands the kernels the pixels tile by tile, only the shape is known up front
+        job.source.width = IMAGE_WIDTH;
+        job.source.height = IMAGE_HEIGHT;
+        job.source.layout = IMAGE_LAYOUT;
+        job.source.format = IMAGE_FORMAT;
+    }
+    return job;
 }
 
 
 /*
-    Populates new image by performing an inverse map on the original image
+    Picks the kernel for the job and prints what is going to run
  */
-void populateTransformedPixmap(pixel ** &pixmap) {
+WarpKernel selectAndReportKernel(const WarpJob &job, const ThreadPool &pool) {
+    WarpKernel kernel = WARP_PLAN->kernel();
+    cout << "\nTransform class: " << transformClassName(WARP_PLAN->transformClass()) << "\n";
+    cout << "Warping with the " << warpKernelName(kernel) << " kernel (" << simdIsaName(WARP_ISA) << ", "
+         << warpFilterName(WARP_FILTER) << " filter, " << edgeModeName(WARP_EDGE) << " edges, "
+         << minifyModeName(WARP_MINIFY) << " minification) on "
+         << pool.threadCount() << " threads\n";
+    cout << "Pixels stored " << imageLayoutName(job.source.layout) << " as " << pixelFormatName(job.source.format)
+         << "\n";
+    return kernel;
+}
 
-    Matrix3x3 inverse_matrix = TRANSFORM_MATRIX.inv();
 
-    cout << "\nCalculated Inverse Matrix:\n";
-    cout << inverse_matrix;
-
-     for (int row = 0; row < NEW_IMAGE_HEIGHT; row++)
-        for (int col = 0; col < NEW_IMAGE_WIDTH; col++) {
-            Vector3d pixel_out(col, row, 1.0);
-            pixel_out = pixel_out + TRANSFORMED_ORIGIN;
-            Vector3d pixel_in = inverse_matrix * pixel_out;
-
-            // normalize the pixmap
-            float u = (float) pixel_in[0] / pixel_in[2];
-            float v = (float) pixel_in[1] / pixel_in[2];
-
-
-            // basic interpolation
-            if ((int) round(v) > (IMAGE_HEIGHT - 1) or (int) round(u) > (IMAGE_WIDTH - 1) or
-                    (int) round(v) < 0 or (int) round(u) < 0) {
-                TRANSFORMED_PIXMAP[row][col].r = 0.0;
-                TRANSFORMED_PIXMAP[row][col].g = 0.0;
-                TRANSFORMED_PIXMAP[row][col].b = 0.0;
-                TRANSFORMED_PIXMAP[row][col].a = 0.0;
-            }
-            else
-                TRANSFORMED_PIXMAP[row][col] = pixmap[(int)round(v)][(int)round(u)];
-        }
+/*
+    Warps output rows row_begin .. row_end - 1, out of core when the source is read through the cache
+ */
+void warpRows(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int row_begin, int row_end) {
+    if (!SOURCE_CACHE)
+        warpTiledRows(job, kernel, pool, row_begin, row_end);
+    else if (!SOURCE_CACHE->warpTiledRows(job, kernel, pool, row_begin, row_end))
+        handleError("Could not read input file: " + SOURCE_CACHE->error(), true);
+}
+
+
+/*
+    Prints how well the source cache did, if the source was read through it
+ */
+void reportSourceCache() {
+    if (!SOURCE_CACHE)
+        return;
+    cout << "Source cache: " << 100.0 * SOURCE_CACHE->hitRate() << "% hits, "
+         << SOURCE_CACHE->bytesRead() / (1024.0 * 1024.0) << " MB read from the input file\n";
 }
 
 
+/*
+    Builds TRANSFORMED_IMAGE by performing an inverse map on the original image
+ */
+void populateTransformedPixmap(const Image &source, ThreadPool &pool) {
+    ScopedStage stage("warp");
+    TRANSFORMED_IMAGE = Image(NEW_IMAGE_WIDTH, NEW_IMAGE_HEIGHT, outputLayout(), IMAGE_FORMAT);
+    WarpJob job = createWarpJob(source, TRANSFORMED_IMAGE.view());
+    WarpKernel kernel = selectAndReportKernel(job, pool);
+    warpRows(job, getWarpKernelFunction(kernel), pool, 0, NEW_IMAGE_HEIGHT);
+    reportSourceCache();
+}
+
+
+/* Warps the original image band by band and writes every band as soon as it is done
+ * input		- original image, output file name, threads warping the bands
+ * output		- None
+ * side effect	- writes the transformed image to a file, kills program on write errors
+ *
+ * Bands are one tile high. While the pool warps a band, a second thread encodes the previous one,
+ * so two bands are all the output memory ever needed. Images are stored bottom up, the band
+ * covering the top of the file is warped first and its buffer holds the rows in file order.
+ */
+void streamTransformedImage(const Image &source, const char * output_file_name, ThreadPool &pool) {
+    ScopedStage stage("warp");
+    const int band_height = WARP_TILE_SIZE;
+    const int channels = 4; // RGBA
+
+    ImageOutput *out = ImageOutput::create (output_file_name);
+    if (! out)
+        handleError("Could not create output file", true);
+    ImageSpec spec (NEW_IMAGE_WIDTH, NEW_IMAGE_HEIGHT, channels, pixelFormatType(IMAGE_FORMAT));
+    if (! out->open (output_file_name, spec))
+        handleError("Could not open output file: " + out->geterror(), true);
+
+    Image bands[2] = {Image(NEW_IMAGE_WIDTH, band_height, outputLayout(), IMAGE_FORMAT),
+                      Image(NEW_IMAGE_WIDTH, band_height, outputLayout(), IMAGE_FORMAT)};
+
+    WarpJob job = createWarpJob(source, ImageView());
+    WarpKernelFunction kernel = getWarpKernelFunction(selectAndReportKernel(job, pool));
+
+    future<bool> written;
+    for (int band = 0, file_row = 0; file_row < NEW_IMAGE_HEIGHT; band++, file_row += band_height) {
+        int file_row_end = min(file_row + band_height, NEW_IMAGE_HEIGHT);
+        ImageView buffer = bands[band % 2].view();
+
+        // the destination is the whole output with only the rows of this band backed by the buffer,
+        // flipped so scanline file_row is the first row of the buffer
+        job.destination = buffer.flipped().shifted(band_height - NEW_IMAGE_HEIGHT + file_row);
+        job.destination.height = NEW_IMAGE_HEIGHT;
+
+        // the writer is busy with the previous band in the other buffer meanwhile
+        warpRows(job, kernel, pool, NEW_IMAGE_HEIGHT - file_row_end, NEW_IMAGE_HEIGHT - file_row);
+
+        // scanlines have to reach the file in order, one writer at a time
+        if (written.valid() and !written.get())
+            handleError("Could not write output file: " + out->geterror(), true);
+        written = async(launch::async, [out, buffer, file_row, file_row_end] {
+            bool written = writeScanlines(out, buffer, file_row, file_row_end);
+            if (written)
+                reportFirstPixel("written");
+            return written;
+        });
+    }
+
+    if (written.valid() and !written.get())
+        handleError("Could not write output file: " + out->geterror(), true);
+    out->close ();
+    delete out;
+    cout << "SUCCESS: Image successfully written to " << output_file_name << "\n";
+    reportSourceCache();
+}
+
+
+#ifndef WARP_HEADLESS
 /* Draw Image to opengl display
  * input		- None
  * output		- None
@@ -435,8 +604,14 @@ void drawImage() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glRasterPos2i(0,0);
-    glDrawPixels(NEW_IMAGE_WIDTH, NEW_IMAGE_HEIGHT, GL_RGBA, GL_FLOAT, TRANSFORMED_PIXMAP[0]);
+    // rows are padded, the display copy is always interleaved and never half
+    ImageView image = TRANSFORMED_IMAGE.view();
+    GLenum type = image.format == FORMAT_UINT8 ? GL_UNSIGNED_BYTE :
+                  image.format == FORMAT_UINT16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint) (image.row_stride / (4 * pixelFormatSize(image.format))));
+    glDrawPixels(image.width, image.height, GL_RGBA, type, image.data);
     glFlush();
+    reportFirstPixel("displayed");
 }
 
 
@@ -483,37 +658,245 @@ void openGlInit(int argc, char* argv[]) {
     // callback routine to handle each event that is detected
     glutMainLoop();
 }
+#endif
 
 
-int main(int argc, char *argv[]) {
-    char *output_file_name;
-    pixel ** pixmap;
-    string user_input = "null"; // initialize string to a word that does not start with the letter 'd'
+/* Reads a whole text file
+ * input	- file name
+ * output	- the contents of the file
+ * side effect - kills program if the file cannot be read
+ */
+string readTextFile(const char * file_name) {
+    ifstream file(file_name);
+    if (!file)
+        handleError(string("Could not open ") + file_name, true);
+    stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+
+/* Parses the command line into the input and output file names and the warp options
+ * input	- command line arguments
+ * output	- None
+ * side effect - sets INPUT_FILENAME, OUTPUT_FILENAME, IMAGE_LAYOUT, NATIVE_FORMAT, IMAGE_FORMAT,
+ *               STREAM_OUTPUT, MEMORY_BUDGET_MB, TRANSFORM_SCRIPT, BATCH_FILENAME, PIPELINE_DEPTH, STATS_FORMAT,
+ *               HEADLESS and the WARP_ options,
+ *               kills program on bad arguments
+ */
+void parseCommandLine(int argc, char *argv[]) {
+    const string usage = "Proper use:\n$> warper [--kernel auto|reference|scanline|simd] [--threads n]"
+                         " [--isa auto|scalar|avx2|avx512] [--filter nearest|bilinear|bicubic|mitchell]"
+                         " [--edge black|clamp|wrap|mirror] [--minify none|trilinear|ewa] [--layout interleaved|planar|tiled]"
+                         " [--format native|uint8|uint16|half|float] [--stream]"
+                         " [--memory-budget MB] [--script file | -e commands] [--batch list] [--pipeline-depth n]"
+                         " [--stats text|json] [--headless] input.img [output.img]";
+    vector<char *> file_names;
+
+    WARP_ISA = detectSimdIsa();
+
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "-k" or argument == "--kernel") {
+            if (i + 1 >= argc or !parseWarpKernel(argv[++i], WARP_KERNEL))
+                handleError(usage, 1);
+        }
+        else if (argument == "-j" or argument == "--threads") {
+            if (i + 1 >= argc)
+                handleError(usage, 1);
+            WARP_THREADS = atoi(argv[++i]);
+        }
+        else if (argument == "--isa") {
+            if (i + 1 >= argc or !parseSimdIsa(argv[++i], WARP_ISA))
+                handleError(usage, 1);
+            if (!simdIsaSupported(WARP_ISA))
+                handleError(string("This CPU does not support ") + simdIsaName(WARP_ISA), 1);
+        }
+        else if (argument == "--filter") {
+            if (i + 1 >= argc or !parseWarpFilter(argv[++i], WARP_FILTER))
+                handleError(usage, 1);
+        }
+        else if (argument == "--edge") {
+            if (i + 1 >= argc or !parseEdgeMode(argv[++i], WARP_EDGE))
+                handleError(usage, 1);
+        }
+        else if (argument == "--minify") {
+            if (i + 1 >= argc or !parseMinifyMode(argv[++i], WARP_MINIFY))
+                handleError(usage, 1);
+        }
+        else if (argument == "--layout") {
+            if (i + 1 >= argc or !parseImageLayout(argv[++i], IMAGE_LAYOUT))
+                handleError(usage, 1);
+        }
+        else if (argument == "--format") {
+            if (i + 1 >= argc)
+                handleError(usage, 1);
+            string format = argv[++i];
+            NATIVE_FORMAT = format == "native";
+            if (!NATIVE_FORMAT and !parsePixelFormat(format, IMAGE_FORMAT))
+                handleError(usage, 1);
+        }
+        else if (argument == "--stream")
+            STREAM_OUTPUT = true;
+        else if (argument == "--memory-budget") {
+            if (i + 1 >= argc or (MEMORY_BUDGET_MB = atof(argv[++i])) <= 0.0)
+                handleError(usage, 1);
+        }
+        else if (argument == "--script") {
+            if (i + 1 >= argc)
+                handleError(usage, 1);
+            TRANSFORM_SCRIPT = readTextFile(argv[++i]);
+        }
+        else if (argument == "-e" or argument == "--transform") {
+            if (i + 1 >= argc)
+                handleError(usage, 1);
+            TRANSFORM_SCRIPT = argv[++i];
+        }
+        else if (argument == "--batch") {
+            if (i + 1 >= argc)
+                handleError(usage, 1);
+            BATCH_FILENAME = argv[++i];
+        }
+        else if (argument == "--pipeline-depth") {
+            if (i + 1 >= argc or (PIPELINE_DEPTH = atoi(argv[++i])) < 0)
+                handleError(usage, 1);
+        }
+        else if (argument == "--headless")
+            HEADLESS = true;
+        else if (argument == "--stats") {
+            if (i + 1 >= argc or !parseStatsFormat(argv[++i], STATS_FORMAT))
+                handleError(usage, 1);
+        }
+        else if (argument.compare(0, 1, "-") == 0)
+            handleError(usage, 1);
+        else
+            file_names.push_back(argv[i]);
+    }
 
     // check for valid argument values
-    if (argc != 2 and argc != 3)
-        handleError("Proper use:\n$> warper input.img [output.img]", 1);
+    if (BATCH_FILENAME) {
+        if (!file_names.empty())
+            handleError("--batch takes the input and output files from the list", 1);
+    }
+    else if (file_names.size() != 1 and file_names.size() != 2)
+        handleError(usage, 1);
+
+    // without a window the warped image has to go somewhere
+    if ((BATCH_FILENAME or !TRANSFORM_SCRIPT.empty()) and file_names.size() == 1)
+        handleError("batch mode needs an output file", 1);
+    if (HEADLESS and file_names.size() == 1)
+        handleError("--headless needs an output file", 1);
+    if (BATCH_FILENAME and TRANSFORM_SCRIPT.empty())
+        handleError("--batch needs the transform from --script or -e", 1);
+
+    // only the auto kernel knows about filters, edge modes and minification
+    if (WARP_KERNEL != WARP_KERNEL_AUTO and
+            (WARP_FILTER != FILTER_NEAREST or WARP_EDGE != EDGE_BLACK or WARP_MINIFY != MINIFY_NONE))
+        handleError("--kernel can only be forced with the nearest filter, black edges and no minification", 1);
+
+    // the mip pyramid and wrapped or mirrored taps need the whole source in memory
+    if (MEMORY_BUDGET_MB > 0.0 and (WARP_MINIFY != MINIFY_NONE or WARP_EDGE == EDGE_WRAP or WARP_EDGE == EDGE_MIRROR))
+        handleError("--memory-budget only works without minification and with black or clamped edges", 1);
+    // the cache copies the source into windows stored like the output
+    if (MEMORY_BUDGET_MB > 0.0 and IMAGE_LAYOUT == LAYOUT_TILED)
+        handleError("--memory-budget does not work with the tiled layout", 1);
+
+    if (file_names.empty())
+        return;
+    INPUT_FILENAME = file_names[0];
+    if (file_names.size() == 2)
+        OUTPUT_FILENAME = file_names[1];
+    else if (STREAM_OUTPUT)
+        handleError("--stream needs an output file", 1);
+}
 
-    if (argc == 3)
-        OUTPUT_FILENAME = argv[2];
 
-    // read the input image
-    pixmap = readImage(argv[1]);
+/* Applies the commands of a transform script to TRANSFORM_MATRIX
+ * input	- commands separated by new lines or semicolons, blank lines and lines starting with # are skipped
+ * output	- None
+ * side effect - kills program on the first command that cannot be applied, d ends the script early
+ */
+void applyTransformScript(const string &script) {
+    string commands = script;
+    replace(commands.begin(), commands.end(), ';', '\n');
+    stringstream lines(commands);
+    string command;
+
+    while (getline(lines, command)) {
+        command.erase(0, command.find_first_not_of(" \t\r"));
+        if (command.empty() or command[0] == '#')
+            continue;
+        if (command.compare(0, 1, "d") == 0)
+            break;
+        if (!calculateTransformMatrix(command))
+            handleError("Bad transform command: " + command, true);
+    }
+}
 
-    // Get user input and build transformation matrix
-    while(user_input.compare(0, 1, "d") != 0) {
-        getline(cin,user_input);
-        calculateTransformMatrix(user_input);
-        cout << TRANSFORM_MATRIX << "\n";
 
+/* Makes an image returned by readImage the source of the next warp
+ * input	- source image
+ * output	- None
+ * side effect - sets IMAGE_WIDTH, IMAGE_HEIGHT, IMAGE_FORMAT and SOURCE_MIPMAP
+ */
+void setSourceImage(const Image &source) {
+    IMAGE_WIDTH = source.width();
+    IMAGE_HEIGHT = source.height();
+    // a forced format is left alone, the reader thread of a batch reads it
+    if (NATIVE_FORMAT)
+        IMAGE_FORMAT = source.format();
+
+    // the pyramid only depends on the source, build it once before the transform is known
+    if (WARP_MINIFY != MINIFY_NONE) {
+        ScopedStage stage("mipmap");
+        SOURCE_MIPMAP = new MipPyramid(source.view());
     }
+}
 
-    cout << "\nDone transforming matrix\nFinal transform matrix is:\n";
-    cout << TRANSFORM_MATRIX;
 
+/* Loads the input image, or opens it through the source cache with a memory budget
+ * input	- input file name
+ * output	- the source image, empty when it is read through the cache
+ * side effect - sets IMAGE_WIDTH, IMAGE_HEIGHT, IMAGE_FORMAT, SOURCE_CACHE and SOURCE_MIPMAP
+ */
+Image loadSourceImage(const char * input_file_name) {
+    Image source;
+
+    if (MEMORY_BUDGET_MB > 0.0) {
+        ScopedStage stage("read");
+        SOURCE_CACHE = new SourceCache((size_t) (MEMORY_BUDGET_MB * 1024 * 1024));
+        if (!SOURCE_CACHE->open(input_file_name))
+            handleError("Could not open input file: " + SOURCE_CACHE->error(), true);
+        if (SOURCE_CACHE->channels() < 3 || SOURCE_CACHE->channels() > 4)
+            handleError("Application supports 3 or 4 channel images only", 1);
+        IMAGE_WIDTH = SOURCE_CACHE->width();
+        IMAGE_HEIGHT = SOURCE_CACHE->height();
+        if (NATIVE_FORMAT)
+            IMAGE_FORMAT = SOURCE_CACHE->format();
+    }
+    else {
+        string error;
+        source = readImage(input_file_name, error);
+        if (!error.empty())
+            handleError(error, true);
+        setSourceImage(source);
+    }
+
+    return source;
+}
+
+
+/* Warps the loaded source with TRANSFORM_MATRIX
+ * input	- source image, output file name of a streamed warp, threads warping the image, error message
+ * output	- false with the reason in error if the warp cannot be planned
+ * side effect - builds TRANSFORMED_IMAGE unless the output is streamed, which writes the output file
+ *
+ * An image in memory is written by the caller, whose result decides how the program ends.
+ */
+bool warpSourceImage(const Image &source, const char * stream_file_name, ThreadPool &pool, string &error) {
     // create a new image based on the forward transform of the corners of the input image
-    getNewImageDimensions();
-    initializePixmap(TRANSFORMED_PIXMAP, NEW_IMAGE_WIDTH, NEW_IMAGE_HEIGHT);
+    if (!getNewImageDimensions(error))
+        return false;
 
     // old width and height
     cout << "\nOld Image Width and Height\n";
@@ -523,11 +906,272 @@ int main(int argc, char *argv[]) {
     cout << "\nNew Image Width and Height.\n";
     cout << NEW_IMAGE_WIDTH << " " << NEW_IMAGE_HEIGHT << endl;
 
-    populateTransformedPixmap(pixmap);
+    // a streamed image never exists in memory as a whole
+    if (STREAM_OUTPUT) {
+        streamTransformedImage(source, stream_file_name, pool);
+        return true;
+    }
+
+    populateTransformedPixmap(source, pool);
+    return true;
+}
+
+
+/*
+    Frees the source and the warped image before the next image of a batch
+ */
+void releaseImages(Image &source) {
+    source = Image();
+    TRANSFORMED_IMAGE = Image();
+    delete SOURCE_MIPMAP;
+    SOURCE_MIPMAP = NULL;
+    delete SOURCE_CACHE;
+    SOURCE_CACHE = NULL;
+}
 
-    if (argc == 3) // specified output file
-        writeImage(TRANSFORMED_PIXMAP, argv[2], NEW_IMAGE_WIDTH, NEW_IMAGE_HEIGHT);
+
+/* Prints how long every stage of a batch was busy and waiting for the others
+ * input	- the read, warp and write stage, number of images, seconds for the whole batch
+ * output	- None
+ */
+void reportStageTimes(const StageTimer *stages, int stage_count, size_t images, double seconds) {
+    cout << "\n" << images << " images in " << seconds << " s, " << images / seconds << " images per second\n";
+    int bottleneck = 0;
+    for (int i = 0; i < stage_count; i++) {
+        cout << "  " << stages[i].name << ": " << stages[i].busy << " s busy, " << stages[i].waiting
+             << " s waiting\n";
+        if (stages[i].busy > stages[bottleneck].busy)
+            bottleneck = i;
+    }
+    cout << "Bottleneck: " << stages[bottleneck].name << "\n";
+}
+
+
+/* Reads, warps and writes one image after the other
+ * input	- input and output file names, threads warping the images, read, warp and write stage
+ * output	- None
+ * side effect - writes the output files
+ *
+ * Streamed output is written band by band while the image is warped, so it counts as warping.
+ */
+void runSerialBatch(const vector<pair<string, string> > &images, ThreadPool &pool, StageTimer *stages) {
+    StageTimer &read = stages[0], &warp = stages[1], &write = stages[2];
+    for (size_t i = 0; i < images.size(); i++) {
+        cout << "\n[" << i + 1 << "/" << images.size() << "] " << images[i].first << " -> "
+             << images[i].second << "\n";
+
+        read.waited();
+        Image source = loadSourceImage(images[i].first.c_str());
+        read.worked();
+
+        warp.waited();
+        string error;
+        if (!warpSourceImage(source, STREAM_OUTPUT ? images[i].second.c_str() : NULL, pool, error))
+            handleError(error, true);
+        warp.worked();
+
+        if (!STREAM_OUTPUT) {
+            write.waited();
+            if (!writeImage(TRANSFORMED_IMAGE, images[i].second.c_str(), error))
+                handleError(error, true);
+            write.worked();
+        }
+        releaseImages(source);
+    }
+}
+
+
+/* Reads, warps and writes images on three threads
+ * input	- input and output file names, threads warping the images, read, warp and write stage
+ * output	- None
+ * side effect - writes the output files
+ *
+ * A reader thread decodes up to PIPELINE_DEPTH images ahead of the warp, which runs on this thread
+ * and the pool, and a writer thread encodes the warped images from a queue of the same depth. At
+ * most 2 * PIPELINE_DEPTH + 2 sources and warped images are in memory at once.
+ *
+ * A stage that fails, this one included, records why and closes both queues, so all three stop
+ * after their current image. Nothing here ends the program while the reader and writer run, the
+ * error is reported once they are joined. Channel counts are checked by readImage in the reader.
+ */
+void runPipelinedBatch(const vector<pair<string, string> > &images, ThreadPool &pool, StageTimer *stages) {
+    typedef pair<size_t, Image> Item;  // index into images, source or warped image
+    BoundedQueue<Item> decoded(PIPELINE_DEPTH), warped(PIPELINE_DEPTH);
+    string read_error, warp_error, write_error;  // each set by its own thread only
+    atomic<bool> failed(false);
+
+    thread reader([&] {
+        StageTimer &read = stages[0];
+        for (size_t i = 0; i < images.size(); i++) {
+            Image source = readImage(images[i].first, read_error);
+            read.worked();
+            if (!read_error.empty()) {
+                failed = true;
+                warped.close();
+                break;
+            }
+            bool queued = decoded.push(Item(i, move(source)));
+            read.waited();
+            if (!queued)
+                break;
+        }
+        decoded.close();
+    });
+
+    thread writer([&] {
+        StageTimer &write = stages[2];
+        Item item;
+        while (warped.pop(item)) {
+            write.waited();
+            bool written = writeImage(item.second, images[item.first].second.c_str(), write_error);
+            item.second = Image();
+            write.worked();
+            if (!written) {
+                failed = true;
+                decoded.close();
+                warped.close();
+                break;
+            }
+        }
+    });
+
+    StageTimer &warp = stages[1];
+    Item item;
+    while (!failed and decoded.pop(item)) {
+        warp.waited();
+        size_t i = item.first;
+        cout << "\n[" << i + 1 << "/" << images.size() << "] " << images[i].first << " -> "
+             << images[i].second << "\n";
+
+        setSourceImage(item.second);
+        bool planned = warpSourceImage(item.second, NULL, pool, warp_error);
+        Image warped_image = move(TRANSFORMED_IMAGE);
+        releaseImages(item.second);
+        warp.worked();
+        if (!planned) {
+            failed = true;
+            decoded.close();
+            warped.close();
+            break;
+        }
+
+        warped.push(Item(i, move(warped_image)));
+        warp.waited();
+    }
+    warped.close();
+
+    reader.join();
+    writer.join();
+    if (!read_error.empty())
+        handleError(read_error, true);
+    if (!warp_error.empty())
+        handleError(warp_error, true);
+    if (!write_error.empty())
+        handleError(write_error, true);
+}
+
+
+/* Runs the transform script over every input and output pair without opening a window
+ * input	- threads warping the images
+ * output	- None
+ * side effect - writes the output files, kills program on the first failure
+ *
+ * The list holds one input and one output file name per line, blank lines and lines starting
+ * with # are skipped. Without a list the pair comes from the command line. Images are read,
+ * warped and written in a pipeline unless PIPELINE_DEPTH is 0 or the output is streamed or the
+ * source cached, which overlap reading or writing with the warp already.
+ */
+void runBatch(ThreadPool &pool) {
+    applyTransformScript(TRANSFORM_SCRIPT);
+    cout << "\nFinal transform matrix is:\n";
+    cout << TRANSFORM_MATRIX;
+
+    vector<pair<string, string> > images;
+    if (BATCH_FILENAME) {
+        stringstream lines(readTextFile(BATCH_FILENAME));
+        string line;
+        while (getline(lines, line)) {
+            stringstream names(line);
+            string input, output;
+            if (!(names >> input) or input[0] == '#')
+                continue;
+            if (!(names >> output))
+                handleError("Missing output file for " + input + " in " + BATCH_FILENAME, true);
+            images.push_back(make_pair(input, output));
+        }
+    }
+    else
+        images.push_back(make_pair(string(INPUT_FILENAME), string(OUTPUT_FILENAME)));
+
+    // the matrix and the threads are shared by all images
+    StageTimer stages[3] = {StageTimer("read"), StageTimer("warp"), StageTimer("write")};
+    StageTimer::Clock::time_point start = StageTimer::Clock::now();
+    if (PIPELINE_DEPTH > 0 and !STREAM_OUTPUT and MEMORY_BUDGET_MB == 0.0)
+        runPipelinedBatch(images, pool, stages);
+    else
+        runSerialBatch(images, pool, stages);
+    double seconds = chrono::duration<double>(StageTimer::Clock::now() - start).count();
+    reportStageTimes(stages, 3, images.size(), seconds);
+    cout << "Warp plans: " << PLAN_CACHE.misses() << " compiled, " << PLAN_CACHE.hits() << " reused\n";
+}
+
+
+int main(int argc, char *argv[]) {
+    Image source;
+    string user_input = "null"; // initialize string to a word that does not start with the letter 'd'
+
+    parseCommandLine(argc, argv);
+    enableStats(STATS_FORMAT != STATS_OFF);
+    ThreadPool pool(WARP_THREADS);
+
+    // batch mode never touches stdin or GLUT
+    if (!TRANSFORM_SCRIPT.empty()) {
+        runBatch(pool);
+        printStats(stderr, STATS_FORMAT);
+        return 0;
+    }
+
+    // read the input image
+    source = loadSourceImage(INPUT_FILENAME);
+
+    // Get user input and build transformation matrix
+    while(user_input.compare(0, 1, "d") != 0) {
+        // the end of a piped stdin ends the commands like d
+        if (!getline(cin,user_input))
+            break;
+        calculateTransformMatrix(user_input);
+        cout << TRANSFORM_MATRIX << "\n";
+
+    }
+
+    cout << "\nDone transforming matrix\nFinal transform matrix is:\n";
+    cout << TRANSFORM_MATRIX;
+
+    string error;
+    if (!warpSourceImage(source, OUTPUT_FILENAME, pool, error))
+        handleError(error, true);
+
+    // specified output file, a window still shows the image if it cannot be written
+    bool written = true;
+    if (OUTPUT_FILENAME and !STREAM_OUTPUT and !writeImage(TRANSFORMED_IMAGE, OUTPUT_FILENAME, error)) {
+        handleError(error, false);
+        written = false;
+    }
+    printStats(stderr, STATS_FORMAT);
+
+    // a streamed image never exists in memory as a whole, so there is nothing to display,
+    // and a headless run exits right after writing, failing if the file is not there
+    if (STREAM_OUTPUT or HEADLESS)
+        return written ? 0 : 1;
+
+#ifndef WARP_HEADLESS
+    // glDrawPixels takes interleaved pixels only, and half floats not everywhere
+    if (IMAGE_FORMAT == FORMAT_HALF)
+        TRANSFORMED_IMAGE = TRANSFORMED_IMAGE.converted(LAYOUT_INTERLEAVED, FORMAT_FLOAT);
+    else if (TRANSFORMED_IMAGE.layout() == LAYOUT_PLANAR)
+        TRANSFORMED_IMAGE = TRANSFORMED_IMAGE.converted(LAYOUT_INTERLEAVED);
 
     openGlInit(argc, argv);
+#endif
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,140 @@
+#include "filters.h"
+#include <cmath>
+
+using namespace std;
+
+
+/*
+    Mitchell-Netravali cubic with parameters B and C evaluated at distance x from the sample
+ */
+static double cubicWeight(double x, double B, double C) {
+    x = fabs(x);
+    if (x < 1.0)
+        return ((12.0 - 9.0 * B - 6.0 * C) * x * x * x + (-18.0 + 12.0 * B + 6.0 * C) * x * x + (6.0 - 2.0 * B)) / 6.0;
+    if (x < 2.0)
+        return ((-B - 6.0 * C) * x * x * x + (6.0 * B + 30.0 * C) * x * x + (-12.0 * B - 48.0 * C) * x +
+                (8.0 * B + 24.0 * C)) / 6.0;
+    return 0.0;
+}
+
+
+int filterTaps(WarpFilter filter) {
+    switch (filter) {
+        case FILTER_BILINEAR:
+            return 2;
+        case FILTER_CATMULL_ROM:
+        case FILTER_MITCHELL:
+            return 4;
+        case FILTER_NEAREST:
+        default:
+            return 1;
+    }
+}
+
+
+/*
+    True if the filter reproduces the source pixel exactly at integer positions
+ */
+bool filterInterpolates(WarpFilter filter) {
+    return filter != FILTER_MITCHELL;
+}
+
+
+/*
+    Tabulates the filter for every phase, each set of weights is normalized to sum to one
+ */
+FilterTable buildFilterTable(WarpFilter filter) {
+    FilterTable table;
+    table.taps = filterTaps(filter);
+    table.weights.resize(FILTER_PHASES * table.taps);
+
+    for (int phase = 0; phase < FILTER_PHASES; phase++) {
+        double offset = (double) phase / FILTER_PHASES;
+        double weights[4] = {1.0, 0.0, 0.0, 0.0};
+        double sum = 0.0;
+
+        for (int tap = 0; tap < table.taps; tap++) {
+            double distance = tap - (table.taps / 2 - 1) - offset;
+            switch (filter) {
+                case FILTER_BILINEAR:
+                    weights[tap] = 1.0 - fabs(distance);
+                    break;
+                case FILTER_CATMULL_ROM:
+                    weights[tap] = cubicWeight(distance, 0.0, 0.5);
+                    break;
+                case FILTER_MITCHELL:
+                    weights[tap] = cubicWeight(distance, 1.0 / 3.0, 1.0 / 3.0);
+                    break;
+                case FILTER_NEAREST:
+                default:
+                    break;
+            }
+            sum += weights[tap];
+        }
+
+        for (int tap = 0; tap < table.taps; tap++)
+            table.weights[phase * table.taps + tap] = (float) (weights[tap] / sum);
+    }
+
+    return table;
+}
+
+
+bool parseWarpFilter(const string &name, WarpFilter &filter) {
+    if (name == "nearest")
+        filter = FILTER_NEAREST;
+    else if (name == "bilinear")
+        filter = FILTER_BILINEAR;
+    else if (name == "bicubic" or name == "catmull-rom")
+        filter = FILTER_CATMULL_ROM;
+    else if (name == "mitchell")
+        filter = FILTER_MITCHELL;
+    else
+        return false;
+    return true;
+}
+
+
+bool parseEdgeMode(const string &name, EdgeMode &edge) {
+    if (name == "black")
+        edge = EDGE_BLACK;
+    else if (name == "clamp")
+        edge = EDGE_CLAMP;
+    else if (name == "wrap")
+        edge = EDGE_WRAP;
+    else if (name == "mirror")
+        edge = EDGE_MIRROR;
+    else
+        return false;
+    return true;
+}
+
+
+const char * warpFilterName(WarpFilter filter) {
+    switch (filter) {
+        case FILTER_BILINEAR:
+            return "bilinear";
+        case FILTER_CATMULL_ROM:
+            return "catmull-rom";
+        case FILTER_MITCHELL:
+            return "mitchell";
+        case FILTER_NEAREST:
+        default:
+            return "nearest";
+    }
+}
+
+
+const char * edgeModeName(EdgeMode edge) {
+    switch (edge) {
+        case EDGE_CLAMP:
+            return "clamp";
+        case EDGE_WRAP:
+            return "wrap";
+        case EDGE_MIRROR:
+            return "mirror";
+        case EDGE_BLACK:
+        default:
+            return "black";
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef _H_Filters
+#define _H_Filters
+
+#include <string>
+#include <vector>
+
+/*
+    Reconstruction filters used to resample the source image
+ */
+enum WarpFilter {
+    FILTER_NEAREST,      // round(u), round(v), the original lookup
+    FILTER_BILINEAR,     // 2x2 taps
+    FILTER_CATMULL_ROM,  // 4x4 taps, interpolating cubic (B = 0, C = 1/2)
+    FILTER_MITCHELL      // 4x4 taps, smoother Mitchell-Netravali cubic (B = 1/3, C = 1/3)
+};
+
+/*
+    What a filter tap that falls outside the source image reads
+ */
+enum EdgeMode {
+    EDGE_BLACK,   // transparent black, the original behaviour
+    EDGE_CLAMP,   // nearest edge pixel
+    EDGE_WRAP,    // the image repeats
+    EDGE_MIRROR   // the image repeats mirrored
+};
+
+#define FILTER_PHASES 256
+
+/*
+    Filter weights precomputed for FILTER_PHASES evenly spaced sub-pixel offsets. The weights of the
+    taps around a sample at fractional offset phase / FILTER_PHASES start at weights[phase * taps],
+    the first tap is at floor(u) - (taps / 2 - 1).
+ */
+struct FilterTable {
+    int taps;
+    std::vector<float> weights;
+};
+
+FilterTable buildFilterTable(WarpFilter filter);
+int filterTaps(WarpFilter filter);
+bool filterInterpolates(WarpFilter filter);
+
+bool parseWarpFilter(const std::string &name, WarpFilter &filter);
+bool parseEdgeMode(const std::string &name, EdgeMode &edge);
+const char * warpFilterName(WarpFilter filter);
+const char * edgeModeName(EdgeMode edge);
+
+
+/*
+    Maps a source row or column index onto the image according to the edge mode,
+    returns -1 when the tap reads transparent black
+ */
+static inline int edgeIndex(int i, int n, EdgeMode edge) {
+    if (i >= 0 and i < n)
+        return i;
+
+    switch (edge) {
+        case EDGE_CLAMP:
+            return i < 0 ? 0 : n - 1;
+        case EDGE_WRAP:
+            i %= n;
+            return i < 0 ? i + n : i;
+        case EDGE_MIRROR: {
+            int period = 2 * n;
+            i %= period;
+            if (i < 0)
+                i += period;
+            return i < n ? i : period - 1 - i;
+        }
+        case EDGE_BLACK:
+        default:
+            return -1;
+    }
+}
+
+#endif
@@ -0,0 +1,268 @@
+#include "image.h"
+#include "stats.h"
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+
+unsigned char *ImageView::sample(int channel, int x, int y) const {
+    int size = pixelFormatSize(format);
+    if (layout == LAYOUT_PLANAR)
+        return data + channel * plane_stride + y * row_stride + (ptrdiff_t) x * size;
+    if (layout == LAYOUT_TILED) {
+        int block = (x >> IMAGE_BLOCK_SHIFT) << (2 * IMAGE_BLOCK_SHIFT);
+        int offset = ((y & (IMAGE_BLOCK_SIZE - 1)) << IMAGE_BLOCK_SHIFT) + (x & (IMAGE_BLOCK_SIZE - 1));
+        return data + (y >> IMAGE_BLOCK_SHIFT) * row_stride + ((ptrdiff_t) (block + offset) * 4 + channel) * size;
+    }
+    return data + y * row_stride + ((ptrdiff_t) x * 4 + channel) * size;
+}
+
+
+Image::Image() : data(NULL), image_width(0), image_height(0), image_layout(LAYOUT_INTERLEAVED),
+                 image_format(FORMAT_FLOAT), row_stride(0), plane_stride(0) {
+}
+
+
+Image::Image(int width, int height, ImageLayout layout, PixelFormat format) : data(NULL), image_width(width),
+                                                                              image_height(height),
+                                                                              image_layout(layout),
+                                                                              image_format(format) {
+    if (layout == LAYOUT_TILED) {
+        // a row of blocks is a whole number of cache lines already
+        ptrdiff_t blocks = (width + IMAGE_BLOCK_SIZE - 1) >> IMAGE_BLOCK_SHIFT;
+        row_stride = blocks * IMAGE_BLOCK_SIZE * IMAGE_BLOCK_SIZE * 4 * pixelFormatSize(format);
+    } else {
+        ptrdiff_t row_bytes = (ptrdiff_t) width * (layout == LAYOUT_INTERLEAVED ? 4 : 1) * pixelFormatSize(format);
+        row_stride = (row_bytes + IMAGE_ROW_ALIGNMENT - 1) / IMAGE_ROW_ALIGNMENT * IMAGE_ROW_ALIGNMENT;
+    }
+    plane_stride = layout == LAYOUT_PLANAR ? row_stride * height : 0;
+
+    if (bytes() > 0) {
+        void *storage;
+        if (posix_memalign(&storage, IMAGE_ROW_ALIGNMENT, bytes()) != 0)
+            throw bad_alloc();
+        data = (unsigned char *) storage;
+        countAllocation(bytes());
+    }
+}
+
+
+Image::Image(Image &&other) : data(other.data), image_width(other.image_width), image_height(other.image_height),
+                              image_layout(other.image_layout), image_format(other.image_format),
+                              row_stride(other.row_stride), plane_stride(other.plane_stride) {
+    other.data = NULL;
+    other.image_width = other.image_height = 0;
+}
+
+
+Image &Image::operator=(Image &&other) {
+    if (this != &other) {
+        free(data);
+        data = other.data;
+        image_width = other.image_width;
+        image_height = other.image_height;
+        image_layout = other.image_layout;
+        image_format = other.image_format;
+        row_stride = other.row_stride;
+        plane_stride = other.plane_stride;
+        other.data = NULL;
+        other.image_width = other.image_height = 0;
+    }
+    return *this;
+}
+
+
+Image::~Image() {
+    free(data);
+}
+
+
+int Image::width() const {
+    return image_width;
+}
+
+
+int Image::height() const {
+    return image_height;
+}
+
+
+ImageLayout Image::layout() const {
+    return image_layout;
+}
+
+
+PixelFormat Image::format() const {
+    return image_format;
+}
+
+
+bool Image::empty() const {
+    return data == NULL;
+}
+
+
+ImageView Image::view() const {
+    ImageView view;
+    view.data = data;
+    view.width = image_width;
+    view.height = image_height;
+    view.layout = image_layout;
+    view.format = image_format;
+    view.row_stride = row_stride;
+    view.plane_stride = plane_stride;
+    return view;
+}
+
+
+void Image::clear() {
+    if (data)
+        memset(data, 0, bytes());
+}
+
+
+size_t Image::bytes() const {
+    if (image_layout == LAYOUT_TILED)
+        return (size_t) row_stride * ((image_height + IMAGE_BLOCK_SIZE - 1) >> IMAGE_BLOCK_SHIFT);
+    return (size_t) row_stride * image_height * (image_layout == LAYOUT_PLANAR ? 4 : 1);
+}
+
+
+Image Image::converted(ImageLayout layout) const {
+    return convertImage(view(), layout, image_format);
+}
+
+
+Image Image::converted(ImageLayout layout, PixelFormat format) const {
+    return convertImage(view(), layout, format);
+}
+
+
+template <ImageLayout layout, typename T>
+static void setOpaqueStorage(const ImageView &image) {
+    const T one = Sample<T>::one();
+    for (int row = 0; row < image.height; row++)
+        for (int col = 0; col < image.width; col++)
+            *(T *) image.sample(3, col, row) = one;
+}
+
+
+void setOpaque(const ImageView &image) {
+    DISPATCH_STORAGE(image, setOpaqueStorage, image);
+}
+
+
+template <ImageLayout layout, typename T>
+static void loadRow(const ImageView &image, int row, pixel *out) {
+    for (int col = 0; col < image.width; col++)
+        out[col] = Pixels<layout, T>::load(image, col, row);
+}
+
+
+// through sample() rather than Pixels<layout, T>::store, which writes tiled images interleaved
+template <ImageLayout layout, typename T>
+static void storeRow(const ImageView &image, int row, const pixel *in) {
+    for (int col = 0; col < image.width; col++) {
+        *(T *) image.sample(0, col, row) = Sample<T>::fromFloat(in[col].r);
+        *(T *) image.sample(1, col, row) = Sample<T>::fromFloat(in[col].g);
+        *(T *) image.sample(2, col, row) = Sample<T>::fromFloat(in[col].b);
+        *(T *) image.sample(3, col, row) = Sample<T>::fromFloat(in[col].a);
+    }
+}
+
+
+/*
+    Samples of the same format are copied as they are, anything else goes through a float row
+ */
+Image convertImage(const ImageView &source, ImageLayout layout, PixelFormat format) {
+    Image copy(source.width, source.height, layout, format);
+    ImageView to = copy.view();
+
+    if (format == source.format) {
+        int size = pixelFormatSize(format);
+        for (int row = 0; row < source.height; row++)
+            for (int col = 0; col < source.width; col++)
+                for (int channel = 0; channel < 4; channel++)
+                    memcpy(to.sample(channel, col, row), source.sample(channel, col, row), size);
+        return copy;
+    }
+
+    pixel *values = new pixel[source.width];
+    for (int row = 0; row < source.height; row++) {
+        DISPATCH_STORAGE(source, loadRow, source, row, values);
+        DISPATCH_STORAGE(to, storeRow, to, row, values);
+    }
+    delete [] values;
+    return copy;
+}
+
+
+bool parseImageLayout(const string &name, ImageLayout &layout) {
+    if (name == "interleaved")
+        layout = LAYOUT_INTERLEAVED;
+    else if (name == "planar")
+        layout = LAYOUT_PLANAR;
+    else if (name == "tiled")
+        layout = LAYOUT_TILED;
+    else
+        return false;
+    return true;
+}
+
+
+const char * imageLayoutName(ImageLayout layout) {
+    switch (layout) {
+        case LAYOUT_PLANAR:
+            return "planar";
+        case LAYOUT_TILED:
+            return "tiled";
+        case LAYOUT_INTERLEAVED:
+        default:
+            return "interleaved";
+    }
+}
+
+
+int pixelFormatSize(PixelFormat format) {
+    switch (format) {
+        case FORMAT_UINT8:
+            return 1;
+        case FORMAT_UINT16:
+        case FORMAT_HALF:
+            return 2;
+        case FORMAT_FLOAT:
+        default:
+            return 4;
+    }
+}
+
+
+bool parsePixelFormat(const string &name, PixelFormat &format) {
+    if (name == "uint8")
+        format = FORMAT_UINT8;
+    else if (name == "uint16")
+        format = FORMAT_UINT16;
+    else if (name == "half")
+        format = FORMAT_HALF;
+    else if (name == "float")
+        format = FORMAT_FLOAT;
+    else
+        return false;
+    return true;
+}
+
+
+const char * pixelFormatName(PixelFormat format) {
+    switch (format) {
+        case FORMAT_UINT8:
+            return "uint8";
+        case FORMAT_UINT16:
+            return "uint16";
+        case FORMAT_HALF:
+            return "half";
+        case FORMAT_FLOAT:
+        default:
+            return "float";
+    }
+}
@@ -0,0 +1,385 @@
+#ifndef _H_Image
+#define _H_Image
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include "pixel.h"
+
+/*
+    How the four channels of an image are arranged in memory
+ */
+enum ImageLayout {
+    LAYOUT_INTERLEAVED,  // r g b a of a pixel next to each other
+    LAYOUT_PLANAR,       // one plane per channel, vector kernels load a channel of consecutive pixels at once
+    LAYOUT_TILED         // interleaved 16x16 pixel blocks, rotated reads stay in few cache lines, sources only
+};
+
+/*
+    Type of one channel sample. Integer samples are normalized, 0 is black and the largest value is 1.
+ */
+enum PixelFormat {
+    FORMAT_UINT8,
+    FORMAT_UINT16,
+    FORMAT_HALF,   // IEEE 754 binary16
+    FORMAT_FLOAT
+};
+
+#define IMAGE_ROW_ALIGNMENT 64  // bytes, every row of every plane starts on a cache line
+#define IMAGE_BLOCK_SHIFT 4     // tiled images are made of 16x16 pixel blocks
+#define IMAGE_BLOCK_SIZE (1 << IMAGE_BLOCK_SHIFT)
+
+/*
+    Non-owning description of pixel storage, this is what the kernels work on. Strides are in bytes,
+    sample c of pixel (x, y) starts at data + y * row_stride + (x * 4 + c) * size in interleaved and at
+    data + c * plane_stride + y * row_stride + x * size in planar layout, size being the sample size
+    of the format. row_stride may be negative for images stored top down.
+
+    Tiled images store the blocks row by row and the pixels of a block row by row, interleaved.
+    row_stride is the distance between rows of blocks, pixel (x, y) starts at
+    data + (y / 16) * row_stride + ((x / 16) * 256 + (y % 16) * 16 + x % 16) * 4 * size.
+    shifted() and flipped() only work for the other layouts.
+ */
+struct ImageView {
+    unsigned char *data;
+    int width;
+    int height;
+    ImageLayout layout;
+    PixelFormat format;
+    std::ptrdiff_t row_stride;    // bytes from one row to the next
+    std::ptrdiff_t plane_stride;  // bytes from one channel plane to the next, planar layout only
+
+    // view whose row y is row y + rows of this one, rows may lie outside this view
+    ImageView shifted(int rows) const {
+        ImageView view = *this;
+        view.data = data + rows * row_stride;
+        return view;
+    }
+
+    // view with the rows in reverse order, the images are stored bottom up and files top down
+    ImageView flipped() const {
+        ImageView view = shifted(height - 1);
+        view.row_stride = -row_stride;
+        return view;
+    }
+
+    // first byte of sample channel of pixel (x, y), for code that moves samples without looking at them
+    unsigned char *sample(int channel, int x, int y) const;
+};
+
+/*
+    Four channel image owning 64 byte aligned storage with rows padded to a multiple of the
+    alignment. Images are movable but not copyable, use converted() for an explicit copy.
+ */
+class Image {
+public:
+    Image();
+    Image(int width, int height, ImageLayout layout = LAYOUT_INTERLEAVED, PixelFormat format = FORMAT_FLOAT);
+    Image(Image &&other);
+    Image &operator=(Image &&other);
+    ~Image();
+
+    int width() const;
+    int height() const;
+    ImageLayout layout() const;
+    PixelFormat format() const;
+    bool empty() const;
+
+    ImageView view() const;
+
+    void clear();  // transparent black, including the padding
+    Image converted(ImageLayout layout) const;
+    Image converted(ImageLayout layout, PixelFormat format) const;
+
+private:
+    unsigned char *data;
+    int image_width;
+    int image_height;
+    ImageLayout image_layout;
+    PixelFormat image_format;
+    std::ptrdiff_t row_stride;
+    std::ptrdiff_t plane_stride;
+
+    size_t bytes() const;
+
+    Image(const Image &);
+    Image &operator=(const Image &);
+};
+
+void setOpaque(const ImageView &image);  // every alpha sample to 1, for images read from 3 channel files
+
+// copy of any view in the given storage, samples are converted through float when the formats differ
+Image convertImage(const ImageView &source, ImageLayout layout, PixelFormat format);
+
+bool parseImageLayout(const std::string &name, ImageLayout &layout);
+const char * imageLayoutName(ImageLayout layout);
+
+int pixelFormatSize(PixelFormat format);  // bytes per sample
+bool parsePixelFormat(const std::string &name, PixelFormat &format);
+const char * pixelFormatName(PixelFormat format);
+
+/*
+    Half precision sample, only ever converted to and from float
+ */
+struct Half {
+    unsigned short bits;
+};
+
+inline float halfToFloat(unsigned short bits) {
+    unsigned sign = (unsigned) (bits & 0x8000) << 16;
+    unsigned exponent = (bits >> 10) & 0x1f;
+    unsigned mantissa = bits & 0x3ff;
+    union { unsigned u; float f; } value;
+
+    if (exponent == 0) {
+        // zero and subnormals are mantissa * 2^-24
+        value.f = mantissa * (1.0f / 16777216.0f);
+        value.u |= sign;
+    }
+    else if (exponent == 31)
+        value.u = sign | 0x7f800000 | (mantissa << 13);
+    else
+        value.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    return value.f;
+}
+
+// rounds to nearest even like the hardware conversion
+inline unsigned short floatToHalf(float f) {
+    union { float f; unsigned u; } value;
+    value.f = f;
+    unsigned sign = (value.u >> 16) & 0x8000;
+    unsigned magnitude = value.u & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000)  // infinity stays infinity, NaN stays a quiet NaN
+        return (unsigned short) (sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+    if (magnitude >= 0x477ff000)  // 65520 and above round to infinity
+        return (unsigned short) (sign | 0x7c00);
+    if (magnitude < 0x38800000) {  // below the smallest normal half 2^-14, the scaling is exact
+        value.u = magnitude;
+        float scaled = value.f * 16777216.0f;
+        unsigned truncated = (unsigned) scaled;
+        float rest = scaled - truncated;
+        unsigned rounded = truncated + (rest > 0.5f or (rest == 0.5f and (truncated & 1)));
+        return (unsigned short) (sign | rounded);
+    }
+    unsigned rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+    return (unsigned short) (sign | ((rounded - 0x38000000) >> 13));
+}
+
+/*
+    Conversion of one sample type to and from the float the filters compute in
+ */
+template <typename T>
+struct Sample;
+
+template <>
+struct Sample<float> {
+    static inline float toFloat(float s) { return s; }
+    static inline float fromFloat(float f) { return f; }
+    static inline float one() { return 1.0f; }
+};
+
+template <>
+struct Sample<unsigned char> {
+    static inline float toFloat(unsigned char s) { return s * (1.0f / 255.0f); }
+    static inline unsigned char fromFloat(float f) {
+        return !(f > 0.0f) ? 0 : f >= 1.0f ? 255 : (unsigned char) (f * 255.0f + 0.5f);
+    }
+    static inline unsigned char one() { return 255; }
+};
+
+template <>
+struct Sample<unsigned short> {
+    static inline float toFloat(unsigned short s) { return s * (1.0f / 65535.0f); }
+    static inline unsigned short fromFloat(float f) {
+        return !(f > 0.0f) ? 0 : f >= 1.0f ? 65535 : (unsigned short) (f * 65535.0f + 0.5f);
+    }
+    static inline unsigned short one() { return 65535; }
+};
+
+template <>
+struct Sample<Half> {
+    static inline float toFloat(Half s) { return halfToFloat(s.bits); }
+    static inline Half fromFloat(float f) { Half s = {floatToHalf(f)}; return s; }
+    static inline Half one() { Half s = {0x3c00}; return s; }
+};
+
+/*
+    Pixel access for the kernels, one specialization per layout and sample type so the storage is
+    resolved at compile time and the inner loops see plain strided loads and stores. load and store
+    convert to and from float, copy and copyPixel move samples unchanged.
+ */
+template <ImageLayout layout, typename T = float>
+struct Pixels;
+
+template <typename T>
+struct Pixels<LAYOUT_INTERLEAVED, T> {
+    // the four samples of pixel (x, y)
+    static inline T *at(const ImageView &image, int x, int y) {
+        return (T *) (image.data + y * image.row_stride) + 4 * x;
+    }
+
+    static inline pixel load(const ImageView &image, int x, int y) {
+        const T *s = at(image, x, y);
+        pixel p;
+        p.r = Sample<T>::toFloat(s[0]);
+        p.g = Sample<T>::toFloat(s[1]);
+        p.b = Sample<T>::toFloat(s[2]);
+        p.a = Sample<T>::toFloat(s[3]);
+        return p;
+    }
+
+    static inline void store(const ImageView &image, int x, int y, const pixel &p) {
+        T *s = at(image, x, y);
+        s[0] = Sample<T>::fromFloat(p.r);
+        s[1] = Sample<T>::fromFloat(p.g);
+        s[2] = Sample<T>::fromFloat(p.b);
+        s[3] = Sample<T>::fromFloat(p.a);
+    }
+
+    // transparent black for count pixels starting at (x, y)
+    static inline void clear(const ImageView &image, int x, int y, int count) {
+        if (count > 0)
+            memset(at(image, x, y), 0, count * 4 * sizeof(T));
+    }
+
+    // count pixels of a source row starting at (source_x, source_y) to (x, y)
+    static inline void copy(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                            int source_y, int count) {
+        if (count > 0)
+            memcpy(at(image, x, y), at(source, source_x, source_y), count * 4 * sizeof(T));
+    }
+
+    static inline void copyPixel(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                                 int source_y) {
+        memcpy(at(image, x, y), at(source, source_x, source_y), 4 * sizeof(T));
+    }
+};
+
+template <typename T>
+struct Pixels<LAYOUT_PLANAR, T> {
+    static inline T *at(const ImageView &image, int channel, int x, int y) {
+        return (T *) (image.data + channel * image.plane_stride + y * image.row_stride) + x;
+    }
+
+    static inline pixel load(const ImageView &image, int x, int y) {
+        pixel p;
+        p.r = Sample<T>::toFloat(*at(image, 0, x, y));
+        p.g = Sample<T>::toFloat(*at(image, 1, x, y));
+        p.b = Sample<T>::toFloat(*at(image, 2, x, y));
+        p.a = Sample<T>::toFloat(*at(image, 3, x, y));
+        return p;
+    }
+
+    static inline void store(const ImageView &image, int x, int y, const pixel &p) {
+        *at(image, 0, x, y) = Sample<T>::fromFloat(p.r);
+        *at(image, 1, x, y) = Sample<T>::fromFloat(p.g);
+        *at(image, 2, x, y) = Sample<T>::fromFloat(p.b);
+        *at(image, 3, x, y) = Sample<T>::fromFloat(p.a);
+    }
+
+    static inline void clear(const ImageView &image, int x, int y, int count) {
+        if (count > 0)
+            for (int channel = 0; channel < 4; channel++)
+                memset(at(image, channel, x, y), 0, count * sizeof(T));
+    }
+
+    static inline void copy(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                            int source_y, int count) {
+        if (count > 0)
+            for (int channel = 0; channel < 4; channel++)
+                memcpy(at(image, channel, x, y), at(source, channel, source_x, source_y), count * sizeof(T));
+    }
+
+    static inline void copyPixel(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                                 int source_y) {
+        for (int channel = 0; channel < 4; channel++)
+            *at(image, channel, x, y) = *at(source, channel, source_x, source_y);
+    }
+};
+
+/*
+    Tiled images are only ever warped from, into interleaved destinations. load, at and the source
+    side of copy address the blocks, store, clear and the destination side of copy are interleaved.
+ */
+template <typename T>
+struct Pixels<LAYOUT_TILED, T> {
+    typedef Pixels<LAYOUT_INTERLEAVED, T> Destination;
+
+    static inline T *at(const ImageView &image, int x, int y) {
+        const int mask = IMAGE_BLOCK_SIZE - 1;
+        int block = (x >> IMAGE_BLOCK_SHIFT) << (2 * IMAGE_BLOCK_SHIFT);
+        int offset = ((y & mask) << IMAGE_BLOCK_SHIFT) + (x & mask);
+        return (T *) (image.data + (y >> IMAGE_BLOCK_SHIFT) * image.row_stride) + 4 * (block + offset);
+    }
+
+    static inline pixel load(const ImageView &image, int x, int y) {
+        const T *s = at(image, x, y);
+        pixel p;
+        p.r = Sample<T>::toFloat(s[0]);
+        p.g = Sample<T>::toFloat(s[1]);
+        p.b = Sample<T>::toFloat(s[2]);
+        p.a = Sample<T>::toFloat(s[3]);
+        return p;
+    }
+
+    static inline void store(const ImageView &image, int x, int y, const pixel &p) {
+        Destination::store(image, x, y, p);
+    }
+
+    static inline void clear(const ImageView &image, int x, int y, int count) {
+        Destination::clear(image, x, y, count);
+    }
+
+    // a source row is contiguous up to the end of each block
+    static inline void copy(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                            int source_y, int count) {
+        while (count > 0) {
+            int run = std::min(count, IMAGE_BLOCK_SIZE - (source_x & (IMAGE_BLOCK_SIZE - 1)));
+            memcpy(Destination::at(image, x, y), at(source, source_x, source_y), run * 4 * sizeof(T));
+            x += run;
+            source_x += run;
+            count -= run;
+        }
+    }
+
+    static inline void copyPixel(const ImageView &image, int x, int y, const ImageView &source, int source_x,
+                                 int source_y) {
+        memcpy(Destination::at(image, x, y), at(source, source_x, source_y), 4 * sizeof(T));
+    }
+};
+
+/*
+    Calls function<layout, T>(...) for the layout and sample type of image, so kernels are written
+    once as templates and instantiated for every storage
+ */
+#define DISPATCH_STORAGE(image, function, ...)                                                                \
+    do {                                                                                                      \
+        ImageLayout dispatch_layout = (image).layout;                                                         \
+        switch ((image).format) {                                                                             \
+            case FORMAT_UINT8:                                                                                \
+                dispatch_layout == LAYOUT_PLANAR ? function<LAYOUT_PLANAR, unsigned char>(__VA_ARGS__) :      \
+                dispatch_layout == LAYOUT_TILED ? function<LAYOUT_TILED, unsigned char>(__VA_ARGS__)          \
+                                                : function<LAYOUT_INTERLEAVED, unsigned char>(__VA_ARGS__);   \
+                break;                                                                                        \
+            case FORMAT_UINT16:                                                                               \
+                dispatch_layout == LAYOUT_PLANAR ? function<LAYOUT_PLANAR, unsigned short>(__VA_ARGS__) :     \
+                dispatch_layout == LAYOUT_TILED ? function<LAYOUT_TILED, unsigned short>(__VA_ARGS__)         \
+                                                : function<LAYOUT_INTERLEAVED, unsigned short>(__VA_ARGS__);  \
+                break;                                                                                        \
+            case FORMAT_HALF:                                                                                 \
+                dispatch_layout == LAYOUT_PLANAR ? function<LAYOUT_PLANAR, Half>(__VA_ARGS__) :               \
+                dispatch_layout == LAYOUT_TILED ? function<LAYOUT_TILED, Half>(__VA_ARGS__)                   \
+                                                : function<LAYOUT_INTERLEAVED, Half>(__VA_ARGS__);            \
+                break;                                                                                        \
+            case FORMAT_FLOAT:                                                                                \
+            default:                                                                                          \
+                dispatch_layout == LAYOUT_PLANAR ? function<LAYOUT_PLANAR, float>(__VA_ARGS__) :              \
+                dispatch_layout == LAYOUT_TILED ? function<LAYOUT_TILED, float>(__VA_ARGS__)                  \
+                                                : function<LAYOUT_INTERLEAVED, float>(__VA_ARGS__);           \
+                break;                                                                                        \
+        }                                                                                                     \
+    } while (0)
+
+#endif
@@ -0,0 +1,537 @@
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+
+/*
+    Along an output row the homogeneous source coordinate h = (hx, hy, hw) is linear in the column.
+    Wherever hw keeps its sign the source bounds low <= hx / hw <= high turn into linear inequalities,
+    so the row is split where hw = 0 and each side is clipped to an interval in closed form, the span
+    covers both. The inequalities are linear in the row as well and are set up once per tile. The
+    bounds are widened by a pixel and the span by a column on each side so the rounding of the
+    kernels, which evaluate h differently, can never move a pixel outside of it.
+ */
+SpanClipper::SpanClipper(const WarpJob &job, const WarpTile &tile, double radius) : row_spans(NULL), sides(0),
+                                                                                    col_begin(tile.col_begin),
+                                                                                    col_end(tile.col_end),
+                                                                                    clipping(false) {
+    if (job.row_spans and job.row_span_radius == radius) {
+        row_spans = job.row_spans;
+        clipping = true;
+        return;
+    }
+
+    const Matrix3x3 &m = job.inverse_matrix;
+    const double margin = radius + 1.0;
+    const double low[2] = {-0.5 - margin, -0.5 - margin};
+    const double high[2] = {job.source.width - 0.5 + margin, job.source.height - 0.5 + margin};
+
+    // the tile maps onto the convex quad of its corners if hw has the same sign at all of them, if
+    // the corners are inside the source so is the tile
+    const int cols[2] = {tile.col_begin, tile.col_end - 1};
+    const int rows[2] = {tile.row_begin, tile.row_end - 1};
+    int positive = 0, inside = 0;
+    for (int i = 0; i < 4; i++) {
+        double x = cols[i & 1] + job.origin[0];
+        double y = rows[i >> 1] + job.origin[1];
+        double hw = m[2][0] * x + m[2][1] * y + m[2][2];
+        double u = (m[0][0] * x + m[0][1] * y + m[0][2]) / hw;
+        double v = (m[1][0] * x + m[1][1] * y + m[1][2]) / hw;
+        positive += hw > 0.0;
+        inside += u >= 0.0 and u <= job.source.width - 1.0 and v >= 0.0 and v <= job.source.height - 1.0;
+    }
+    if (inside == 4 and (positive == 0 or positive == 4))
+        return;
+
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            if (!std::isfinite(m[row][col]))
+                return;
+
+    // rows of the matrix combined into h_axis - bound * hw, bound * hw - h_axis and hw
+    double lines[5][3];
+    for (int col = 0; col < 3; col++) {
+        lines[0][col] = m[2][col];
+        for (int axis = 0; axis < 2; axis++) {
+            lines[1 + 2 * axis][col] = m[axis][col] - low[axis] * m[2][col];
+            lines[2 + 2 * axis][col] = high[axis] * m[2][col] - m[axis][col];
+        }
+    }
+
+    for (int sign = -1; sign <= 1; sign += 2) {
+        // an affine transform has hw = m22 everywhere and only ever one side
+        if (m[2][0] == 0.0 and m[2][1] == 0.0 and sign * m[2][2] <= 0.0)
+            continue;
+        for (int i = 0; i < 5; i++) {
+            Bound &bound = bounds[sides][i];
+            bound.p = sign * lines[i][0];
+            bound.inverse_p = 1.0 / bound.p;
+            bound.q_row = sign * lines[i][1];
+            bound.q = bound.p * job.origin[0] + bound.q_row * job.origin[1] + sign * lines[i][2];
+            if (!std::isfinite(bound.inverse_p) and bound.p != 0.0)
+                bound.p = bound.q_row = bound.q = 0.0;  // too flat to clip, never excludes a column
+        }
+        sides++;
+    }
+    clipping = true;
+}
+
+
+bool SpanClipper::clips() const {
+    return clipping;
+}
+
+
+WarpSpan SpanClipper::span(int row) const {
+    WarpSpan span = {col_begin, col_end};
+    if (!clipping)
+        return span;
+    if (row_spans) {
+        // the same clamping as below, the spans of the rows are clamped to the whole output
+        span.begin = max(col_begin, min(col_end, row_spans[row].begin));
+        span.end = max(span.begin, min(col_end, row_spans[row].end));
+        return span;
+    }
+
+    double first = HUGE_VAL, last = -HUGE_VAL;
+    for (int side = 0; side < sides; side++) {
+        double begin = -HUGE_VAL, end = HUGE_VAL;
+        for (int i = 0; i < 5; i++) {
+            const Bound &bound = bounds[side][i];
+            double q = bound.q_row * row + bound.q;
+            if (bound.p > 0.0)
+                begin = max(begin, -q * bound.inverse_p);
+            else if (bound.p < 0.0)
+                end = min(end, -q * bound.inverse_p);
+            else if (q < 0.0)
+                end = -HUGE_VAL;
+        }
+        if (begin <= end) {
+            first = min(first, begin);
+            last = max(last, end);
+        }
+    }
+
+    if (first > last)
+        span.end = col_begin;
+    else {
+        span.begin = (int) max((double) col_begin, min((double) col_end, floor(first) - 1.0));
+        span.end = (int) max((double) span.begin, min((double) col_end, ceil(last) + 2.0));
+    }
+    return span;
+}
+
+
+/*
+    Original inverse map: builds a Vector3d per output pixel and multiplies it through the inverse matrix
+ */
+template <ImageLayout layout, typename T>
+static void warpReferenceTile(const WarpJob &job, const WarpTile &tile) {
+    typedef Pixels<layout, T> P;
+
+    for (int row = tile.row_begin; row < tile.row_end; row++)
+        for (int col = tile.col_begin; col < tile.col_end; col++) {
+            Vector3d pixel_out(col, row, 1.0);
+            pixel_out = pixel_out + job.origin;
+            Vector3d pixel_in = job.inverse_matrix * pixel_out;
+
+            // normalize the pixmap
+            float u = (float) pixel_in[0] / pixel_in[2];
+            float v = (float) pixel_in[1] / pixel_in[2];
+
+            // basic interpolation
+            if ((int) round(v) > (job.source.height - 1) or (int) round(u) > (job.source.width - 1) or
+                    (int) round(v) < 0 or (int) round(u) < 0)
+                P::clear(job.destination, col, row, 1);
+            else
+                P::copyPixel(job.destination, col, row, job.source, (int)round(u), (int)round(v));
+        }
+}
+
+
+void warpReference(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpReferenceTile, job, tile);
+}
+
+
+/*
+    Scanline inverse map: the homogeneous source coordinate of the first pixel of a tile row is computed
+    with the same operation order as the reference kernel, every following pixel adds the first column of
+    the inverse matrix to it. Three adds and a divide per pixel instead of a full matrix vector product.
+ */
+template <ImageLayout layout, typename T>
+static void warpScanlineTile(const WarpJob &job, const WarpTile &tile) {
+    typedef Pixels<layout, T> P;
+    const Matrix3x3 &m = job.inverse_matrix;
+    const double m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const double m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const double m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+    const double origin_x = job.origin[0];
+    const double origin_y = job.origin[1];
+    const int max_u = job.source.width - 1;
+    const int max_v = job.source.height - 1;
+
+    const SpanClipper clipper(job, tile, 0.0);
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        WarpSpan span = clipper.span(row);
+        if (clipper.clips()) {
+            P::clear(job.destination, tile.col_begin, row, span.begin - tile.col_begin);
+            P::clear(job.destination, span.end, row, tile.col_end - span.end);
+        }
+
+        const double x = span.begin + origin_x;
+        const double y = row + origin_y;
+        double hx = m00 * x + m01 * y + m02;
+        double hy = m10 * x + m11 * y + m12;
+        double hw = m20 * x + m21 * y + m22;
+
+        for (int col = span.begin; col < span.end; col++) {
+            float u = (float) hx / hw;
+            float v = (float) hy / hw;
+            int iu = (int) round(u);
+            int iv = (int) round(v);
+
+            if (iv > max_v or iu > max_u or iv < 0 or iu < 0)
+                P::clear(job.destination, col, row, 1);
+            else
+                P::copyPixel(job.destination, col, row, job.source, iu, iv);
+
+            hx += m00;
+            hy += m10;
+            hw += m20;
+        }
+    }
+}
+
+
+void warpScanline(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpScanlineTile, job, tile);
+}
+
+
+/*
+    Integer translation: every output row is a clipped copy of a source row, so nothing is resampled.
+    The offsets are exact because classifyTransform only accepts integral translations with a unit diagonal.
+ */
+template <ImageLayout layout, typename T>
+static void warpCopyTile(const WarpJob &job, const WarpTile &tile) {
+    typedef Pixels<layout, T> P;
+    const Matrix3x3 &m = job.inverse_matrix;
+    const int offset_u = (int) (job.origin[0] + m[0][2]);
+    const int offset_v = (int) (job.origin[1] + m[1][2]);
+
+    // output columns of the tile whose source column lies inside the image
+    int col_begin = max(tile.col_begin, -offset_u);
+    int col_end = min(tile.col_end, job.source.width - offset_u);
+    if (col_end < col_begin)
+        col_end = col_begin = tile.col_end;
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        int v = row + offset_v;
+
+        if (v < 0 or v > job.source.height - 1 or col_begin == col_end) {
+            P::clear(job.destination, tile.col_begin, row, tile.col_end - tile.col_begin);
+            continue;
+        }
+
+        P::clear(job.destination, tile.col_begin, row, col_begin - tile.col_begin);
+        P::copy(job.destination, col_begin, row, job.source, col_begin + offset_u, v, col_end - col_begin);
+        P::clear(job.destination, col_end, row, tile.col_end - col_end);
+    }
+}
+
+
+void warpCopy(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpCopyTile, job, tile);
+}
+
+
+/*
+    Axis aligned scale and translation: u only depends on the column and v only on the row, so the
+    source column of every output column is looked up once per tile and the source row once per row.
+ */
+template <ImageLayout layout, typename T>
+static void warpAxisScaleTile(const WarpJob &job, const WarpTile &tile) {
+    typedef Pixels<layout, T> P;
+    const Matrix3x3 &m = job.inverse_matrix;
+    const int width = tile.col_end - tile.col_begin;
+    vector<int> source_cols(width);
+
+    for (int i = 0; i < width; i++) {
+        double x = (tile.col_begin + i) + job.origin[0];
+        float u = (float) (m[0][0] * x + m[0][2]);
+        int iu = (int) round(u);
+        source_cols[i] = (iu < 0 or iu > job.source.width - 1) ? -1 : iu;
+    }
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        double y = row + job.origin[1];
+        float v = (float) (m[1][1] * y + m[1][2]);
+        int iv = (int) round(v);
+
+        if (iv < 0 or iv > job.source.height - 1) {
+            P::clear(job.destination, tile.col_begin, row, width);
+            continue;
+        }
+
+        for (int i = 0; i < width; i++) {
+            if (source_cols[i] < 0)
+                P::clear(job.destination, tile.col_begin + i, row, 1);
+            else
+                P::copyPixel(job.destination, tile.col_begin + i, row, job.source, source_cols[i], iv);
+        }
+    }
+}
+
+
+void warpAxisScale(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpAxisScaleTile, job, tile);
+}
+
+
+/*
+    General affine transform: same stepping as warpScanline, but the bottom row of the matrix is
+    (0, 0, 1) so the homogeneous coordinate is always 1 and the divide is dropped.
+ */
+template <ImageLayout layout, typename T>
+static void warpAffineTile(const WarpJob &job, const WarpTile &tile) {
+    typedef Pixels<layout, T> P;
+    const Matrix3x3 &m = job.inverse_matrix;
+    const double m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const double m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const double origin_x = job.origin[0];
+    const double origin_y = job.origin[1];
+    const int max_u = job.source.width - 1;
+    const int max_v = job.source.height - 1;
+
+    const SpanClipper clipper(job, tile, 0.0);
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        WarpSpan span = clipper.span(row);
+        if (clipper.clips()) {
+            P::clear(job.destination, tile.col_begin, row, span.begin - tile.col_begin);
+            P::clear(job.destination, span.end, row, tile.col_end - span.end);
+        }
+
+        const double x = span.begin + origin_x;
+        const double y = row + origin_y;
+        double hx = m00 * x + m01 * y + m02;
+        double hy = m10 * x + m11 * y + m12;
+
+        for (int col = span.begin; col < span.end; col++) {
+            int iu = (int) round((float) hx);
+            int iv = (int) round((float) hy);
+
+            if (iv > max_v or iu > max_u or iv < 0 or iu < 0)
+                P::clear(job.destination, col, row, 1);
+            else
+                P::copyPixel(job.destination, col, row, job.source, iu, iv);
+
+            hx += m00;
+            hy += m10;
+        }
+    }
+}
+
+
+void warpAffine(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpAffineTile, job, tile);
+}
+
+
+/*
+    Sorts the inverse transform of a job into the cheapest class that still reproduces the
+    reference kernel exactly
+ */
+TransformClass classifyTransform(const WarpJob &job) {
+    const Matrix3x3 &m = job.inverse_matrix;
+
+    if (m[2][0] != 0.0 or m[2][1] != 0.0 or m[2][2] != 1.0)
+        return TRANSFORM_PROJECTIVE;
+
+    if (m[0][1] != 0.0 or m[1][0] != 0.0)
+        return TRANSFORM_AFFINE;
+
+    if (m[0][0] != 1.0 or m[1][1] != 1.0)
+        return TRANSFORM_AXIS_SCALE;
+
+    double offset_u = job.origin[0] + m[0][2];
+    double offset_v = job.origin[1] + m[1][2];
+    if (offset_u != floor(offset_u) or offset_v != floor(offset_v) or
+            fabs(offset_u) > HUGENUMBER or fabs(offset_v) > HUGENUMBER)
+        return TRANSFORM_AXIS_SCALE;
+
+    if (m[0][2] == 0.0 and m[1][2] == 0.0)
+        return TRANSFORM_IDENTITY;
+    return TRANSFORM_INTEGER_TRANSLATE;
+}
+
+
+/*
+    Resolves WARP_KERNEL_AUTO to the specialized kernel for the transform class of the job, affine and
+    projective transforms go to the vector kernel unless the job is limited to scalar code. Jobs with
+    another filter than nearest or another edge mode than black go to the resampling kernels, only
+    integer translations with an interpolating filter can still be copied. Minification always uses
+    the mipmapped kernel. Any explicitly requested kernel is returned unchanged.
+ */
+WarpKernel selectWarpKernel(const WarpJob &job, WarpKernel requested) {
+    if (requested != WARP_KERNEL_AUTO)
+        return requested;
+
+    if (job.minify != MINIFY_NONE)
+        return WARP_KERNEL_MIPMAPPED;
+
+    TransformClass transform_class = classifyTransform(job);
+
+    if (job.filter != FILTER_NEAREST or job.edge != EDGE_BLACK) {
+        bool copy = job.edge == EDGE_BLACK and filterInterpolates(job.filter);
+        switch (transform_class) {
+            case TRANSFORM_IDENTITY:
+            case TRANSFORM_INTEGER_TRANSLATE:
+                return copy ? WARP_KERNEL_COPY : WARP_KERNEL_FILTERED_AXIS_SCALE;
+            case TRANSFORM_AXIS_SCALE:
+                return WARP_KERNEL_FILTERED_AXIS_SCALE;
+            default:
+                return WARP_KERNEL_FILTERED;
+        }
+    }
+
+    switch (transform_class) {
+        case TRANSFORM_IDENTITY:
+        case TRANSFORM_INTEGER_TRANSLATE:
+            return WARP_KERNEL_COPY;
+        case TRANSFORM_AXIS_SCALE:
+            return WARP_KERNEL_AXIS_SCALE;
+        case TRANSFORM_AFFINE:
+            return job.isa == SIMD_ISA_SCALAR ? WARP_KERNEL_AFFINE : WARP_KERNEL_SIMD;
+        case TRANSFORM_PROJECTIVE:
+        default:
+            return job.isa == SIMD_ISA_SCALAR ? WARP_KERNEL_SCANLINE : WARP_KERNEL_SIMD;
+    }
+}
+
+
+/*
+    Splits the output image into tile_size x tile_size tiles and runs the kernel over them on the pool.
+    The tiling only depends on the image size, so the result is identical for any number of threads.
+ */
+void warpTiled(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int tile_size) {
+    warpTiledRows(job, kernel, pool, 0, job.destination.height, tile_size);
+}
+
+
+/*
+    Same as warpTiled for the output rows row_begin .. row_end - 1 only, the other destination rows
+    are not touched and do not need to point at valid memory
+ */
+void warpTiledRows(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int row_begin, int row_end,
+                   int tile_size) {
+    vector<WarpTile> tiles;
+
+    for (int row = row_begin; row < row_end; row += tile_size)
+        for (int col = 0; col < job.destination.width; col += tile_size) {
+            WarpTile tile;
+            tile.col_begin = col;
+            tile.col_end = min(col + tile_size, job.destination.width);
+            tile.row_begin = row;
+            tile.row_end = min(row + tile_size, row_end);
+            tiles.push_back(tile);
+        }
+
+    pool.run((int) tiles.size(), [&](int i) { kernel(job, tiles[i]); });
+}
+
+
+/*
+    Maps a kernel enum to the function implementing it
+ */
+WarpKernelFunction getWarpKernelFunction(WarpKernel kernel) {
+    switch (kernel) {
+        case WARP_KERNEL_REFERENCE:
+            return warpReference;
+        case WARP_KERNEL_COPY:
+            return warpCopy;
+        case WARP_KERNEL_AXIS_SCALE:
+            return warpAxisScale;
+        case WARP_KERNEL_AFFINE:
+            return warpAffine;
+        case WARP_KERNEL_SIMD:
+            return warpSimd;
+        case WARP_KERNEL_FILTERED:
+            return warpFiltered;
+        case WARP_KERNEL_FILTERED_AXIS_SCALE:
+            return warpFilteredAxisScale;
+        case WARP_KERNEL_MIPMAPPED:
+            return warpMipmapped;
+        case WARP_KERNEL_SCANLINE:
+        default:
+            return warpScanline;
+    }
+}
+
+
+/*
+    Parses a kernel name given on the command line, returns false for unknown names
+ */
+bool parseWarpKernel(const string &name, WarpKernel &kernel) {
+    if (name == "auto")
+        kernel = WARP_KERNEL_AUTO;
+    else if (name == "reference")
+        kernel = WARP_KERNEL_REFERENCE;
+    else if (name == "scanline")
+        kernel = WARP_KERNEL_SCANLINE;
+    else if (name == "simd")
+        kernel = WARP_KERNEL_SIMD;
+    else
+        return false;
+    return true;
+}
+
+
+const char * warpKernelName(WarpKernel kernel) {
+    switch (kernel) {
+        case WARP_KERNEL_AUTO:
+            return "auto";
+        case WARP_KERNEL_REFERENCE:
+            return "reference";
+        case WARP_KERNEL_COPY:
+            return "copy";
+        case WARP_KERNEL_AXIS_SCALE:
+            return "axis scale";
+        case WARP_KERNEL_AFFINE:
+            return "affine";
+        case WARP_KERNEL_SIMD:
+            return "simd";
+        case WARP_KERNEL_FILTERED:
+            return "filtered";
+        case WARP_KERNEL_FILTERED_AXIS_SCALE:
+            return "filtered axis scale";
+        case WARP_KERNEL_MIPMAPPED:
+            return "mipmapped";
+        case WARP_KERNEL_SCANLINE:
+        default:
+            return "scanline";
+    }
+}
+
+
+const char * transformClassName(TransformClass transform_class) {
+    switch (transform_class) {
+        case TRANSFORM_IDENTITY:
+            return "identity";
+        case TRANSFORM_INTEGER_TRANSLATE:
+            return "integer translate";
+        case TRANSFORM_AXIS_SCALE:
+            return "axis aligned scale";
+        case TRANSFORM_AFFINE:
+            return "affine";
+        case TRANSFORM_PROJECTIVE:
+        default:
+            return "projective";
+    }
+}
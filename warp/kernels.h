@@ -0,0 +1,137 @@
+#ifndef _H_Kernels
+#define _H_Kernels
+
+#include <string>
+#include "pixel.h"
+#include "image.h"
+#include "threadpool.h"
+#include "simd.h"
+#include "filters.h"
+#include "mipmap.h"
+#include "../vecmat/Vector.h"
+#include "../vecmat/Matrix.h"
+
+/*
+    Inverse-mapping kernels that fill an output image from a source image
+ */
+enum WarpKernel {
+    WARP_KERNEL_AUTO,       // pick the cheapest kernel that is exact for the transform class
+    WARP_KERNEL_REFERENCE,  // per-pixel Matrix3x3 * Vector3d, the original implementation
+    WARP_KERNEL_SCANLINE,   // one matrix product per row, then incremental homogeneous stepping
+    WARP_KERNEL_COPY,       // row copies, identity and integer translations only
+    WARP_KERNEL_AXIS_SCALE, // separable column and row lookup tables, no rotation or shear
+    WARP_KERNEL_AFFINE,     // incremental stepping without the homogeneous divide
+    WARP_KERNEL_SIMD,       // vectorized affine and projective kernel for the instruction set of the job
+    WARP_KERNEL_FILTERED,   // any transform with the filter and edge mode of the job
+    WARP_KERNEL_FILTERED_AXIS_SCALE, // axis aligned scales with the filter of the job, reuses filtered rows
+    WARP_KERNEL_MIPMAPPED   // trilinear or EWA minification from the mip pyramid of the job
+};
+
+/*
+    Classes of inverse transform, from cheapest to most expensive to evaluate
+ */
+enum TransformClass {
+    TRANSFORM_IDENTITY,
+    TRANSFORM_INTEGER_TRANSLATE,
+    TRANSFORM_AXIS_SCALE,
+    TRANSFORM_AFFINE,
+    TRANSFORM_PROJECTIVE
+};
+
+/*
+    Output columns [begin, end) of one row of a tile
+ */
+struct WarpSpan {
+    int begin, end;
+};
+
+/*
+    Everything a kernel needs to know about one warp. Output pixel (col, row) is mapped back
+    through inverse_matrix after being offset by origin (the min corner of the forward mapped image).
+    Source and destination have the same layout and pixel format, except that the destination of a
+    tiled source is interleaved.
+ */
+struct WarpJob {
+    ImageView source;
+    ImageView destination;
+
+    Matrix3x3 inverse_matrix;
+    Vector3d origin;
+
+    SimdIsa isa;
+
+    WarpFilter filter;
+    EdgeMode edge;
+    FilterTable filter_table;  // buildFilterTable(filter)
+
+    MinifyMode minify;
+    const MipPyramid *mipmap;  // pyramid of source, required unless minify is MINIFY_NONE
+
+    // per output row the columns a SpanClipper of row_span_radius would clip every tile to, computed
+    // once by a WarpPlan, or NULL to clip tile by tile
+    const WarpSpan *row_spans = NULL;
+    double row_span_radius = 0.0;
+};
+
+/*
+    Rectangle of output pixels [col_begin, col_end) x [row_begin, row_end) handed to a kernel
+ */
+struct WarpTile {
+    int col_begin, col_end;
+    int row_begin, row_end;
+};
+
+#define WARP_TILE_SIZE 64
+
+/*
+    Per row spans of the output columns of a tile that may map to within radius pixels of the source.
+    Every column outside the span of its row maps further out and is transparent black with black
+    edges, so kernels clear those without evaluating them and test only the pixels inside the span.
+    Tiles that map inside the source as a whole are not clipped at all. With the row spans of the
+    job for the same radius the spans are those, cut to the tile, and nothing is computed per tile.
+ */
+class SpanClipper {
+public:
+    SpanClipper(const WarpJob &job, const WarpTile &tile, double radius);
+
+    bool clips() const;         // false if span() is always the whole row of the tile
+    WarpSpan span(int row) const;
+
+private:
+    // p * col + q_row * row + q >= 0 for the columns of a row that can be inside
+    struct Bound {
+        double p, inverse_p, q_row, q;
+    };
+
+    Bound bounds[2][5];  // per sign of the homogeneous coordinate: its sign, then u and v low and high
+    const WarpSpan *row_spans;
+    int sides;
+    int col_begin, col_end;
+    bool clipping;
+};
+
+typedef void (*WarpKernelFunction)(const WarpJob &job, const WarpTile &tile);
+
+void warpReference(const WarpJob &job, const WarpTile &tile);
+void warpScanline(const WarpJob &job, const WarpTile &tile);
+void warpCopy(const WarpJob &job, const WarpTile &tile);
+void warpAxisScale(const WarpJob &job, const WarpTile &tile);
+void warpAffine(const WarpJob &job, const WarpTile &tile);
+void warpSimd(const WarpJob &job, const WarpTile &tile);
+void warpFiltered(const WarpJob &job, const WarpTile &tile);
+void warpFilteredAxisScale(const WarpJob &job, const WarpTile &tile);
+void warpMipmapped(const WarpJob &job, const WarpTile &tile);
+
+void warpTiled(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int tile_size = WARP_TILE_SIZE);
+void warpTiledRows(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int row_begin, int row_end,
+                   int tile_size = WARP_TILE_SIZE);
+
+TransformClass classifyTransform(const WarpJob &job);
+WarpKernel selectWarpKernel(const WarpJob &job, WarpKernel requested);
+
+WarpKernelFunction getWarpKernelFunction(WarpKernel kernel);
+bool parseWarpKernel(const std::string &name, WarpKernel &kernel);
+const char * warpKernelName(WarpKernel kernel);
+const char * transformClassName(TransformClass transform_class);
+
+#endif
@@ -0,0 +1,76 @@
+#include "mipmap.h"
+#include <algorithm>
+
+using namespace std;
+
+
+/*
+    Builds every level down to 1x1 by averaging 2x2 blocks of the level above it, the last row or
+    column of an odd sized level is averaged with itself
+ */
+MipPyramid::MipPyramid(const ImageView &source) {
+    if (source.layout == LAYOUT_INTERLEAVED and source.format == FORMAT_FLOAT)
+        levels.push_back(source);
+    else {
+        storage.push_back(convertImage(source, LAYOUT_INTERLEAVED, FORMAT_FLOAT));
+        levels.push_back(storage.back().view());
+    }
+
+    while (levels.back().width > 1 or levels.back().height > 1) {
+        const ImageView above = levels.back();
+        storage.push_back(Image(max(1, (above.width + 1) / 2), max(1, (above.height + 1) / 2), LAYOUT_INTERLEAVED));
+        const ImageView next = storage.back().view();
+
+        for (int row = 0; row < next.height; row++) {
+            const pixel *in0 = levelPixel(above, 0, min(2 * row, above.height - 1));
+            const pixel *in1 = levelPixel(above, 0, min(2 * row + 1, above.height - 1));
+            pixel *out = levelPixel(next, 0, row);
+            for (int col = 0; col < next.width; col++) {
+                int c0 = min(2 * col, above.width - 1);
+                int c1 = min(2 * col + 1, above.width - 1);
+                out[col].r = 0.25f * (in0[c0].r + in0[c1].r + in1[c0].r + in1[c1].r);
+                out[col].g = 0.25f * (in0[c0].g + in0[c1].g + in1[c0].g + in1[c1].g);
+                out[col].b = 0.25f * (in0[c0].b + in0[c1].b + in1[c0].b + in1[c1].b);
+                out[col].a = 0.25f * (in0[c0].a + in0[c1].a + in1[c0].a + in1[c1].a);
+            }
+        }
+
+        levels.push_back(next);
+    }
+}
+
+
+int MipPyramid::levelCount() const {
+    return (int) levels.size();
+}
+
+
+const ImageView &MipPyramid::level(int i) const {
+    return levels[i];
+}
+
+
+bool parseMinifyMode(const string &name, MinifyMode &mode) {
+    if (name == "none")
+        mode = MINIFY_NONE;
+    else if (name == "trilinear")
+        mode = MINIFY_TRILINEAR;
+    else if (name == "ewa")
+        mode = MINIFY_EWA;
+    else
+        return false;
+    return true;
+}
+
+
+const char * minifyModeName(MinifyMode mode) {
+    switch (mode) {
+        case MINIFY_TRILINEAR:
+            return "trilinear";
+        case MINIFY_EWA:
+            return "ewa";
+        case MINIFY_NONE:
+        default:
+            return "none";
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef _H_Mipmap
+#define _H_Mipmap
+
+#include <string>
+#include <vector>
+#include "image.h"
+
+/*
+    How output pixels that cover more than one source pixel are filtered
+ */
+enum MinifyMode {
+    MINIFY_NONE,       // the reconstruction filter alone, aliases below a scale of 0.5
+    MINIFY_TRILINEAR,  // bilinear lookups in the two nearest mip levels, isotropic
+    MINIFY_EWA         // elliptical weighted average in one mip level, follows the pixel footprint
+};
+
+/*
+    Box filtered pyramid built once from the source image, every level halves the size of the one
+    before it. All levels are interleaved float. Level 0 is the source itself and is not owned unless
+    the source is stored otherwise, the smaller levels are stored in the pyramid.
+ */
+class MipPyramid {
+public:
+    explicit MipPyramid(const ImageView &source);
+
+    int levelCount() const;
+    const ImageView &level(int i) const;
+
+private:
+    std::vector<ImageView> levels;
+    std::vector<Image> storage;
+
+    MipPyramid(const MipPyramid &);
+    MipPyramid &operator=(const MipPyramid &);
+};
+
+// pixel (x, y) of a level
+inline pixel *levelPixel(const ImageView &level, int x, int y) {
+    return (pixel *) Pixels<LAYOUT_INTERLEAVED>::at(level, x, y);
+}
+
+bool parseMinifyMode(const std::string &name, MinifyMode &mode);
+const char * minifyModeName(MinifyMode mode);
+
+#endif
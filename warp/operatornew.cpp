@@ -0,0 +1,68 @@
+#include "stats.h"
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+
+/*
+    The replaceable allocation functions, counting the bytes asked for while stats are on. The rest
+    of the forms, nothrow and sized, end up here or in free like the library's own. Only linked into
+    the warper, a program embedding the warp library keeps its own allocator.
+ */
+void *operator new(size_t size) {
+    countAllocation(size);
+    void *p;
+    while ((p = malloc(size ? size : 1)) == NULL) {
+        new_handler handler = get_new_handler();
+        if (!handler)
+            throw bad_alloc();
+        handler();
+    }
+    return p;
+}
+
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+
+void *operator new(size_t size, const nothrow_t &) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch (...) {
+        return NULL;
+    }
+}
+
+
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch (...) {
+        return NULL;
+    }
+}
+
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+
+void operator delete(void *p, const nothrow_t &) noexcept {
+    free(p);
+}
+
+
+void operator delete[](void *p, const nothrow_t &) noexcept {
+    free(p);
+}
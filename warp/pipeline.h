@@ -0,0 +1,95 @@
+#ifndef _H_Pipeline
+#define _H_Pipeline
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/*
+    Queue between two threads of a pipeline holding at most capacity items. push() blocks while it
+    is full and pop() while it is empty, so a fast stage can only run capacity items ahead of a slow
+    one. close() ends the stream: pop() returns false once the queue is drained and push() drops
+    its item and returns false.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {
+    }
+
+    bool push(T &&item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed or items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed or !items.empty(); });
+        if (items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+};
+
+/*
+    Seconds a pipeline stage spent working on its items and waiting for its neighbours, the stage
+    that is busy the longest is the bottleneck
+ */
+struct StageTimer {
+    typedef std::chrono::steady_clock Clock;
+
+    const char *name;
+    double busy;
+    double waiting;
+    Clock::time_point mark;
+
+    explicit StageTimer(const char *name) : name(name), busy(0.0), waiting(0.0), mark(Clock::now()) {
+    }
+
+    // ends a stretch of waiting or working that began at the previous call
+    void waited() {
+        waiting += lap();
+    }
+
+    void worked() {
+        busy += lap();
+    }
+
+private:
+    double lap() {
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - mark).count();
+        mark = now;
+        return seconds;
+    }
+};
+
+#endif
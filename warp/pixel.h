@@ -0,0 +1,9 @@
+#ifndef _H_Pixel
+#define _H_Pixel
+
+// Struct Declaration
+struct pixel {
+    float r, g, b, a;
+};
+
+#endif
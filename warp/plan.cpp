@@ -0,0 +1,289 @@
+#include "plan.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+
+WarpSourceSpec::WarpSourceSpec(int width, int height, ImageLayout layout, PixelFormat format)
+        : width(width), height(height), layout(layout), format(format) {
+}
+
+
+WarpOptions::WarpOptions() : kernel(WARP_KERNEL_AUTO), isa(detectSimdIsa()), filter(FILTER_NEAREST),
+                             edge(EDGE_BLACK), minify(MINIFY_NONE) {
+}
+
+
+WarpPlan::WarpPlan() : message("plan not compiled"), output_width(0), output_height(0),
+                       transform_class(TRANSFORM_IDENTITY), warp_kernel(WARP_KERNEL_AUTO), row_span_radius(0.0) {
+}
+
+
+bool WarpPlan::valid() const {
+    return message.empty();
+}
+
+
+string WarpPlan::error() const {
+    return message;
+}
+
+
+const WarpSourceSpec &WarpPlan::source() const {
+    return spec;
+}
+
+
+const WarpOptions &WarpPlan::options() const {
+    return warp_options;
+}
+
+
+int WarpPlan::width() const {
+    return output_width;
+}
+
+
+int WarpPlan::height() const {
+    return output_height;
+}
+
+
+ImageLayout WarpPlan::destinationLayout() const {
+    return spec.layout == LAYOUT_TILED ? LAYOUT_INTERLEAVED : spec.layout;
+}
+
+
+PixelFormat WarpPlan::format() const {
+    return spec.format;
+}
+
+
+const Vector3d &WarpPlan::origin() const {
+    return job_template.origin;
+}
+
+
+const Matrix3x3 &WarpPlan::inverse() const {
+    return job_template.inverse_matrix;
+}
+
+
+TransformClass WarpPlan::transformClass() const {
+    return transform_class;
+}
+
+
+WarpKernel WarpPlan::kernel() const {
+    return warp_kernel;
+}
+
+
+WarpJob WarpPlan::job(const ImageView &source, const ImageView &destination, const MipPyramid *mipmap) const {
+    WarpJob job = job_template;
+    job.source = source;
+    job.destination = destination;
+    job.mipmap = mipmap;
+    job.row_spans = row_spans ? row_spans->data() : NULL;
+    job.row_span_radius = row_span_radius;
+    return job;
+}
+
+
+bool WarpPlan::fits(const ImageView &source, const ImageView &destination) const {
+    return source.width == spec.width and source.height == spec.height and source.layout == spec.layout and
+           source.format == spec.format and destination.width == output_width and
+           destination.height == output_height and destination.layout == destinationLayout() and
+           destination.format == spec.format;
+}
+
+
+bool WarpPlan::execute(const ImageView &source, const ImageView &destination, const MipPyramid *mipmap) const {
+    return run(source, destination, NULL, mipmap);
+}
+
+
+bool WarpPlan::execute(const ImageView &source, const ImageView &destination, ThreadPool &pool,
+                       const MipPyramid *mipmap) const {
+    return run(source, destination, &pool, mipmap);
+}
+
+
+/*
+    Runs the kernel over the tiles of the output, on the pool or on the calling thread
+ */
+bool WarpPlan::run(const ImageView &source, const ImageView &destination, ThreadPool *pool,
+                   const MipPyramid *mipmap) const {
+    if (!valid() or !fits(source, destination))
+        return false;
+
+    unique_ptr<MipPyramid> own_mipmap;
+    if (warp_options.minify != MINIFY_NONE and !mipmap) {
+        own_mipmap.reset(new MipPyramid(source));
+        mipmap = own_mipmap.get();
+    }
+
+    WarpJob warp_job = job(source, destination, mipmap);
+    WarpKernelFunction function = getWarpKernelFunction(warp_kernel);
+    if (pool)
+        warpTiled(warp_job, function, *pool);
+    else
+        for (int row = 0; row < output_height; row += WARP_TILE_SIZE)
+            for (int col = 0; col < output_width; col += WARP_TILE_SIZE) {
+                WarpTile tile;
+                tile.col_begin = col;
+                tile.col_end = min(col + WARP_TILE_SIZE, output_width);
+                tile.row_begin = row;
+                tile.row_end = min(row + WARP_TILE_SIZE, output_height);
+                function(warp_job, tile);
+            }
+    return true;
+}
+
+
+/*
+    Radius the kernel clips rows with, see SpanClipper, negative for kernels that do not clip
+ */
+static double clipRadius(WarpKernel kernel, const FilterTable &filter_table) {
+    switch (kernel) {
+        case WARP_KERNEL_SCANLINE:
+        case WARP_KERNEL_AFFINE:
+        case WARP_KERNEL_SIMD:
+            return 0.0;
+        case WARP_KERNEL_FILTERED:
+            return filter_table.taps / 2;
+        default:
+            return -1.0;
+    }
+}
+
+
+/*
+    Sizes the output on the forward mapped corners of the source, like the warper always has,
+    resolves the kernel and clips every output row once for it. The plan is invalid, with the
+    reason in error(), for an empty source or a forced kernel with options only the auto kernel
+    knows about.
+ */
+WarpPlan compileWarpPlan(const Matrix3x3 &forward, const WarpSourceSpec &source, const WarpOptions &options) {
+    WarpPlan plan;
+    plan.message.clear();
+    plan.spec = source;
+    plan.warp_options = options;
+
+    if (source.width <= 0 or source.height <= 0)
+        plan.message = "the source is empty";
+    else if (options.kernel != WARP_KERNEL_AUTO and
+             (options.filter != FILTER_NEAREST or options.edge != EDGE_BLACK or options.minify != MINIFY_NONE))
+        plan.message = "a kernel can only be forced with the nearest filter, black edges and no minification";
+    if (!plan.message.empty())
+        return plan;
+
+    // bottom left, top left, top right and bottom right corner
+    const double corners_x[4] = {0.0, 0.0, (double) source.width, source.width - 1.0};
+    const double corners_y[4] = {0.0, source.height - 1.0, (double) source.height, 0.0};
+    double x[4], y[4];
+    forward.transformPoints(corners_x, corners_y, x, y, 4, true);
+
+    int max_x = (int) *max_element(x, x + 4);
+    int max_y = (int) *max_element(y, y + 4);
+    int min_x = (int) *min_element(x, x + 4);
+    int min_y = (int) *min_element(y, y + 4);
+    plan.output_width = abs(max_x - min_x);
+    plan.output_height = abs(max_y - min_y);
+
+    WarpJob &job = plan.job_template;
+    job.inverse_matrix = forward.inv();
+    job.origin = Vector3d(min_x, min_y, 0.0);
+    job.isa = options.isa;
+    job.filter = options.filter;
+    job.edge = options.edge;
+    job.filter_table = buildFilterTable(options.filter);
+    job.minify = options.minify;
+    job.mipmap = NULL;
+
+    plan.transform_class = classifyTransform(job);
+    plan.warp_kernel = selectWarpKernel(job, options.kernel);
+
+    // a clipper of the whole output gives every tile's spans, unless the whole output maps inside
+    double radius = clipRadius(plan.warp_kernel, job.filter_table);
+    if (radius >= 0.0 and plan.output_width > 0 and plan.output_height > 0) {
+        WarpJob shape = job;
+        shape.source.width = source.width;
+        shape.source.height = source.height;
+        WarpTile whole = {0, plan.output_width, 0, plan.output_height};
+        SpanClipper clipper(shape, whole, radius);
+        if (clipper.clips()) {
+            vector<WarpSpan> *spans = new vector<WarpSpan>(plan.output_height);
+            for (int row = 0; row < plan.output_height; row++)
+                (*spans)[row] = clipper.span(row);
+            plan.row_spans.reset(spans);
+            plan.row_span_radius = radius;
+        }
+    }
+    return plan;
+}
+
+
+WarpPlanCache::WarpPlanCache(size_t capacity) : capacity(capacity > 0 ? capacity : 1), hit_count(0), miss_count(0) {
+}
+
+
+shared_ptr<const WarpPlan> WarpPlanCache::get(const Matrix3x3 &forward, const WarpSourceSpec &source,
+                                              const WarpOptions &options) {
+    // the matrix by its bits, so only the very same transform hits
+    Key key(9);
+    for (int i = 0; i < 9; i++) {
+        double coefficient = forward[i / 3][i % 3];
+        memcpy(&key[i], &coefficient, sizeof(double));
+    }
+    const int fields[] = {source.width, source.height, source.layout, source.format, options.kernel, options.isa,
+                          options.filter, options.edge, options.minify};
+    key.insert(key.end(), fields, fields + sizeof(fields) / sizeof(fields[0]));
+
+    lock_guard<std::mutex> lock(mutex);
+    map<Key, Entries::iterator>::iterator found = index.find(key);
+    if (found != index.end()) {
+        hit_count++;
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->second;
+    }
+
+    // compiled under the lock, threads missing on the same key compile it once
+    miss_count++;
+    shared_ptr<const WarpPlan> plan = make_shared<WarpPlan>(compileWarpPlan(forward, source, options));
+    entries.push_front(make_pair(key, plan));
+    index[key] = entries.begin();
+    if (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    return plan;
+}
+
+
+size_t WarpPlanCache::size() const {
+    lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+
+size_t WarpPlanCache::hits() const {
+    lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+}
+
+
+size_t WarpPlanCache::misses() const {
+    lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+}
+
+
+void WarpPlanCache::clear() {
+    lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+}
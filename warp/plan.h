@@ -0,0 +1,129 @@
+#ifndef _H_Plan
+#define _H_Plan
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "kernels.h"
+
+/*
+    Reentrant interface to the warp, for programs that embed it. A plan holds everything about a
+    warp that does not depend on the pixels: the inverse matrix, the size and origin of the output,
+    the kernel, the filter weights and the span of every output row that can map into the source.
+    It is compiled once from the forward matrix, the shape of the source and the options, and then
+    executed on any number of sources of that shape. Nothing is global, plans are never changed by
+    executing them and any number of threads may execute the same plan at once.
+
+        WarpPlan plan = compileWarpPlan(forward, WarpSourceSpec(width, height, layout, format), options);
+        if (!plan.valid())
+            ... plan.error() ...
+        Image destination(plan.width(), plan.height(), plan.destinationLayout(), plan.format());
+        plan.execute(source.view(), destination.view(), pool);
+ */
+struct WarpSourceSpec {
+    int width, height;
+    ImageLayout layout;
+    PixelFormat format;
+
+    WarpSourceSpec(int width = 0, int height = 0, ImageLayout layout = LAYOUT_INTERLEAVED,
+                   PixelFormat format = FORMAT_FLOAT);
+};
+
+struct WarpOptions {
+    WarpKernel kernel;  // forced kernels only go with the nearest filter, black edges and no minification
+    SimdIsa isa;
+    WarpFilter filter;
+    EdgeMode edge;
+    MinifyMode minify;
+
+    WarpOptions();      // auto kernel on the best instruction set, nearest filter, black edges, no minification
+};
+
+class WarpPlan {
+public:
+    WarpPlan();         // invalid until compiled
+
+    bool valid() const;
+    std::string error() const;
+
+    const WarpSourceSpec &source() const;
+    const WarpOptions &options() const;
+    int width() const;                      // of the output, 0 if the source maps to a line or a point
+    int height() const;
+    ImageLayout destinationLayout() const;  // tiled sources are warped into interleaved images
+    PixelFormat format() const;
+    const Vector3d &origin() const;         // output pixel (0, 0) is at this point of the forward mapped source
+    const Matrix3x3 &inverse() const;
+    TransformClass transformClass() const;
+    WarpKernel kernel() const;              // the one auto resolved to
+
+    // source has to match source(), destination has to be width() x height() in destinationLayout()
+    // and format(). With minification the pyramid of the source is built unless one is passed in.
+    // Returns false, leaving destination alone, if the plan or the images do not fit.
+    bool execute(const ImageView &source, const ImageView &destination, const MipPyramid *mipmap = NULL) const;
+    bool execute(const ImageView &source, const ImageView &destination, ThreadPool &pool,
+                 const MipPyramid *mipmap = NULL) const;
+
+    // the job for the kernels, for callers that tile or band the output themselves
+    WarpJob job(const ImageView &source, const ImageView &destination, const MipPyramid *mipmap = NULL) const;
+
+private:
+    WarpSourceSpec spec;
+    WarpOptions warp_options;
+    std::string message;      // empty if the plan is valid
+    int output_width, output_height;
+    WarpJob job_template;     // everything but the images, the pyramid and the row spans
+    TransformClass transform_class;
+    WarpKernel warp_kernel;
+    std::shared_ptr<const std::vector<WarpSpan> > row_spans;  // shared by copies, NULL if nothing clips
+    double row_span_radius;
+
+    bool fits(const ImageView &source, const ImageView &destination) const;
+    bool run(const ImageView &source, const ImageView &destination, ThreadPool *pool,
+             const MipPyramid *mipmap) const;
+
+    friend WarpPlan compileWarpPlan(const Matrix3x3 &forward, const WarpSourceSpec &source,
+                                    const WarpOptions &options);
+};
+
+WarpPlan compileWarpPlan(const Matrix3x3 &forward, const WarpSourceSpec &source,
+                         const WarpOptions &options = WarpOptions());
+
+/*
+    The plans compiled last, so repeated warps of same size frames with the same transform and
+    options skip compiling. Plans are looked up by the bits of the matrix, the source shape and the
+    options, the least recently used one is dropped when the cache is full. Safe to share between
+    threads, the plans handed out stay valid after they are dropped.
+ */
+class WarpPlanCache {
+public:
+    explicit WarpPlanCache(size_t capacity = 64);
+
+    // the cached plan, compiled and cached first on a miss
+    std::shared_ptr<const WarpPlan> get(const Matrix3x3 &forward, const WarpSourceSpec &source,
+                                        const WarpOptions &options = WarpOptions());
+
+    size_t size() const;
+    size_t hits() const;
+    size_t misses() const;
+    void clear();
+
+private:
+    typedef std::vector<unsigned long long> Key;
+    typedef std::list<std::pair<Key, std::shared_ptr<const WarpPlan> > > Entries;  // most recently used first
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    Entries entries;
+    std::map<Key, Entries::iterator> index;
+    size_t hit_count, miss_count;
+
+    WarpPlanCache(const WarpPlanCache &);
+    WarpPlanCache &operator=(const WarpPlanCache &);
+};
+
+#endif
@@ -0,0 +1,516 @@
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+
+/*
+    Splits a continuous source coordinate into the index of the first filter tap and the phase of
+    the precomputed weights. Pixel centers sit on integer coordinates.
+ */
+static inline void tapPosition(double u, int taps, int &first, int &phase) {
+    double base = floor(u);
+    first = (int) base - (taps / 2 - 1);
+    phase = (int) ((u - base) * FILTER_PHASES + 0.5);
+    if (phase == FILTER_PHASES) {
+        first++;
+        phase = 0;
+    }
+}
+
+
+/*
+    Nearest neighbour lookup of a continuous coordinate in source with the edge mode of the job
+ */
+template <ImageLayout layout, typename T>
+static inline void sampleNearest(const WarpJob &job, const ImageView &source, double u, double v, pixel &out) {
+    int iu = edgeIndex((int) round((float) u), source.width, job.edge);
+    int iv = edgeIndex((int) round((float) v), source.height, job.edge);
+
+    if (iu < 0 or iv < 0)
+        memset(&out, 0, sizeof(pixel));
+    else
+        out = Pixels<layout, T>::load(source, iu, iv);
+}
+
+
+/*
+    Separable filtered lookup in source: the source columns and horizontal weights are resolved once,
+    every tap row is filtered horizontally and the row results are combined with the vertical weights
+ */
+template <int taps, ImageLayout layout, typename T>
+static inline void sampleFiltered(const WarpJob &job, const ImageView &source, double u, double v, pixel &out) {
+    const int width = source.width, height = source.height;
+    int first_u, phase_u, first_v, phase_v;
+    tapPosition(u, taps, first_u, phase_u);
+    tapPosition(v, taps, first_v, phase_v);
+    const float *weights_u = &job.filter_table.weights[phase_u * taps];
+    const float *weights_v = &job.filter_table.weights[phase_v * taps];
+
+    int cols[taps];
+    for (int i = 0; i < taps; i++)
+        cols[i] = edgeIndex(first_u + i, width, job.edge);
+
+    float r = 0.0, g = 0.0, b = 0.0, a = 0.0;
+    for (int j = 0; j < taps; j++) {
+        int row = edgeIndex(first_v + j, height, job.edge);
+        if (row < 0)
+            continue;
+
+        float row_r = 0.0, row_g = 0.0, row_b = 0.0, row_a = 0.0;
+        for (int i = 0; i < taps; i++) {
+            if (cols[i] < 0)
+                continue;
+            pixel p = Pixels<layout, T>::load(source, cols[i], row);
+            row_r += weights_u[i] * p.r;
+            row_g += weights_u[i] * p.g;
+            row_b += weights_u[i] * p.b;
+            row_a += weights_u[i] * p.a;
+        }
+
+        r += weights_v[j] * row_r;
+        g += weights_v[j] * row_g;
+        b += weights_v[j] * row_b;
+        a += weights_v[j] * row_a;
+    }
+
+    out.r = r;
+    out.g = g;
+    out.b = b;
+    out.a = a;
+}
+
+
+template <int taps, ImageLayout layout, typename T>
+static void warpFilteredTile(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    const SpanClipper clipper(job, tile, taps / 2);
+    const bool clip = job.edge == EDGE_BLACK and clipper.clips();
+    const int width = tile.col_end - tile.col_begin;
+    pixel out;
+
+    // output coordinates of the columns, the row coordinate and the source coordinates of a row
+    vector<double> points(4 * width);
+    double *xs = points.data(), *ys = xs + width, *us = ys + width, *vs = us + width;
+    for (int i = 0; i < width; i++)
+        xs[i] = tile.col_begin + i + job.origin[0];
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        // with black edges a pixel is black once all of its taps are off the source, the other edge
+        // modes sample every pixel
+        WarpSpan span = {tile.col_begin, tile.col_end};
+        if (clip) {
+            span = clipper.span(row);
+            Pixels<layout, T>::clear(job.destination, tile.col_begin, row, span.begin - tile.col_begin);
+            Pixels<layout, T>::clear(job.destination, span.end, row, tile.col_end - span.end);
+        }
+
+        const int first = span.begin - tile.col_begin, count = span.end - span.begin;
+        fill(ys, ys + count, row + job.origin[1]);
+        m.transformPoints(xs + first, ys, us, vs, count, true);
+
+        for (int i = 0; i < count; i++) {
+            if (taps == 1)
+                sampleNearest<layout, T>(job, job.source, us[i], vs[i], out);
+            else
+                sampleFiltered<taps, layout, T>(job, job.source, us[i], vs[i], out);
+            Pixels<layout, T>::store(job.destination, span.begin + i, row, out);
+        }
+    }
+}
+
+
+template <ImageLayout layout, typename T>
+static void warpFilteredStorage(const WarpJob &job, const WarpTile &tile) {
+    switch (job.filter_table.taps) {
+        case 1:
+            warpFilteredTile<1, layout, T>(job, tile);
+            break;
+        case 2:
+            warpFilteredTile<2, layout, T>(job, tile);
+            break;
+        default:
+            warpFilteredTile<4, layout, T>(job, tile);
+            break;
+    }
+}
+
+
+/*
+    Resampling inverse map for any transform, filter and edge mode. The source coordinates of a row
+    are mapped in one batch and every pixel is reconstructed with the job's filter.
+ */
+void warpFiltered(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpFilteredStorage, job, tile);
+}
+
+
+/*
+    Horizontally filtered copy of one source row for the columns of a tile
+ */
+struct FilteredRow {
+    int source_row;
+    int last_use;
+    vector<pixel> values;
+};
+
+
+template <int taps, ImageLayout layout, typename T>
+static void warpFilteredAxisScaleTile(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    const int width = tile.col_end - tile.col_begin;
+
+    // source columns and horizontal weights of every output column of the tile
+    vector<int> cols(width * taps);
+    vector<const float *> weights_u(width);
+    for (int i = 0; i < width; i++) {
+        double u = m[0][0] * ((tile.col_begin + i) + job.origin[0]) + m[0][2];
+        int first, phase;
+        tapPosition(u, taps, first, phase);
+        weights_u[i] = &job.filter_table.weights[phase * taps];
+        for (int t = 0; t < taps; t++)
+            cols[i * taps + t] = edgeIndex(first + t, job.source.width, job.edge);
+    }
+
+    // consecutive output rows share most of their tap rows, so the horizontal pass of a source row
+    // is kept around until it falls out of this small cache
+    FilteredRow cache[2 * taps];
+    for (int c = 0; c < 2 * taps; c++) {
+        cache[c].source_row = -1;
+        cache[c].last_use = -1;
+        cache[c].values.resize(width);
+    }
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        double v = m[1][1] * (row + job.origin[1]) + m[1][2];
+        int first_v, phase_v;
+        tapPosition(v, taps, first_v, phase_v);
+        const float *weights_v = &job.filter_table.weights[phase_v * taps];
+        const vector<pixel> *tap_rows[taps];
+
+        for (int j = 0; j < taps; j++) {
+            int source_row = edgeIndex(first_v + j, job.source.height, job.edge);
+            tap_rows[j] = NULL;
+            if (source_row < 0)
+                continue;
+
+            FilteredRow *slot = &cache[0];
+            for (int c = 0; c < 2 * taps; c++) {
+                if (cache[c].source_row == source_row) {
+                    slot = &cache[c];
+                    break;
+                }
+                if (cache[c].last_use < slot->last_use)
+                    slot = &cache[c];
+            }
+
+            if (slot->source_row != source_row) {
+                for (int i = 0; i < width; i++) {
+                    const float *w = weights_u[i];
+                    const int *c = &cols[i * taps];
+                    float r = 0.0, g = 0.0, b = 0.0, a = 0.0;
+                    for (int t = 0; t < taps; t++) {
+                        if (c[t] < 0)
+                            continue;
+                        pixel p = Pixels<layout, T>::load(job.source, c[t], source_row);
+                        r += w[t] * p.r;
+                        g += w[t] * p.g;
+                        b += w[t] * p.b;
+                        a += w[t] * p.a;
+                    }
+                    slot->values[i].r = r;
+                    slot->values[i].g = g;
+                    slot->values[i].b = b;
+                    slot->values[i].a = a;
+                }
+                slot->source_row = source_row;
+            }
+            slot->last_use = row;
+            tap_rows[j] = &slot->values;
+        }
+
+        for (int i = 0; i < width; i++) {
+            float r = 0.0, g = 0.0, b = 0.0, a = 0.0;
+            for (int j = 0; j < taps; j++) {
+                if (!tap_rows[j])
+                    continue;
+                const pixel &p = (*tap_rows[j])[i];
+                r += weights_v[j] * p.r;
+                g += weights_v[j] * p.g;
+                b += weights_v[j] * p.b;
+                a += weights_v[j] * p.a;
+            }
+            pixel out = {r, g, b, a};
+            Pixels<layout, T>::store(job.destination, tile.col_begin + i, row, out);
+        }
+    }
+}
+
+
+template <ImageLayout layout, typename T>
+static void warpFilteredAxisScaleStorage(const WarpJob &job, const WarpTile &tile) {
+    switch (job.filter_table.taps) {
+        case 1:
+            warpFilteredTile<1, layout, T>(job, tile);
+            break;
+        case 2:
+            warpFilteredAxisScaleTile<2, layout, T>(job, tile);
+            break;
+        default:
+            warpFilteredAxisScaleTile<4, layout, T>(job, tile);
+            break;
+    }
+}
+
+
+/*
+    Resampling inverse map for axis aligned scales. The filter is applied horizontally once per
+    source row and tile and the filtered rows are reused by every output row they contribute to.
+ */
+void warpFilteredAxisScale(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpFilteredAxisScaleStorage, job, tile);
+}
+
+
+#define EWA_MAX_ANISOTROPY 8
+#define EWA_WEIGHT_SAMPLES 64
+
+/*
+    Gaussian falloff exp(-2 q) tabulated over the squared elliptical radius q in [0, 1)
+ */
+static vector<float> buildEwaWeights() {
+    vector<float> weights(EWA_WEIGHT_SAMPLES);
+    for (int i = 0; i < EWA_WEIGHT_SAMPLES; i++)
+        weights[i] = (float) exp(-2.0 * (i + 0.5) / EWA_WEIGHT_SAMPLES);
+    return weights;
+}
+
+static const vector<float> EWA_WEIGHTS = buildEwaWeights();
+
+
+/*
+    Reconstruction at level 0 with the job's own filter, used wherever the output pixel does not
+    cover more than one source pixel
+ */
+template <int taps>
+static inline void sampleMagnified(const WarpJob &job, double u, double v, pixel &out) {
+    if (taps == 1)
+        sampleNearest<LAYOUT_INTERLEAVED, float>(job, job.mipmap->level(0), u, v, out);
+    else
+        sampleFiltered<taps, LAYOUT_INTERLEAVED, float>(job, job.mipmap->level(0), u, v, out);
+}
+
+
+/*
+    Bilinear lookup in one mip level, adds weight times the sample to rgba. u and v are level 0
+    coordinates and are moved onto the level's pixel centers first.
+ */
+static inline void accumulateBilinear(const ImageView &level, int level_index, EdgeMode edge, double u, double v,
+                                      float weight, float *rgba) {
+    double scale = 1.0 / (1 << level_index);
+    u = (u + 0.5) * scale - 0.5;
+    v = (v + 0.5) * scale - 0.5;
+
+    double base_u = floor(u), base_v = floor(v);
+    float fu = (float) (u - base_u), fv = (float) (v - base_v);
+    int cols[2] = {edgeIndex((int) base_u, level.width, edge), edgeIndex((int) base_u + 1, level.width, edge)};
+    int rows[2] = {edgeIndex((int) base_v, level.height, edge), edgeIndex((int) base_v + 1, level.height, edge)};
+    float weights_u[2] = {1.0f - fu, fu};
+    float weights_v[2] = {1.0f - fv, fv};
+
+    for (int j = 0; j < 2; j++) {
+        if (rows[j] < 0)
+            continue;
+        const pixel *in = levelPixel(level, 0, rows[j]);
+        for (int i = 0; i < 2; i++) {
+            if (cols[i] < 0)
+                continue;
+            float w = weight * weights_v[j] * weights_u[i];
+            rgba[0] += w * in[cols[i]].r;
+            rgba[1] += w * in[cols[i]].g;
+            rgba[2] += w * in[cols[i]].b;
+            rgba[3] += w * in[cols[i]].a;
+        }
+    }
+}
+
+
+/*
+    Trilinear minification: the level of detail is the log2 of the longer screen space derivative,
+    the two levels around it are sampled bilinearly and blended
+ */
+template <int taps>
+static inline void sampleTrilinear(const WarpJob &job, double u, double v, double du_dx, double dv_dx,
+                                   double du_dy, double dv_dy, pixel &out) {
+    double rho = max(du_dx * du_dx + dv_dx * dv_dx, du_dy * du_dy + dv_dy * dv_dy);
+    double lod = 0.5 * log2(rho);
+    if (!(lod > 0.0)) {
+        sampleMagnified<taps>(job, u, v, out);
+        return;
+    }
+
+    int last_level = job.mipmap->levelCount() - 1;
+    int level = last_level;
+    float blend = 0.0f;
+    if (lod < last_level) {
+        level = (int) floor(lod);
+        blend = (float) (lod - level);
+    }
+
+    float rgba[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    accumulateBilinear(job.mipmap->level(level), level, job.edge, u, v, 1.0f - blend, rgba);
+    if (blend > 0.0f)
+        accumulateBilinear(job.mipmap->level(level + 1), level + 1, job.edge, u, v, blend, rgba);
+
+    out.r = rgba[0];
+    out.g = rgba[1];
+    out.b = rgba[2];
+    out.a = rgba[3];
+}
+
+
+/*
+    Elliptical weighted average (Heckbert). The Jacobian maps the output pixel onto an ellipse in the
+    source with covariance J J^T. A level is picked in which the ellipse is at most EWA_MAX_ANISOTROPY
+    texels long, a one texel reconstruction radius is added at that level and every texel inside the
+    ellipse is weighted with a Gaussian of its elliptical radius.
+ */
+template <int taps>
+static inline void sampleEwa(const WarpJob &job, double u, double v, double du_dx, double dv_dx,
+                             double du_dy, double dv_dy, pixel &out) {
+    double a = du_dx * du_dx + du_dy * du_dy;
+    double b = du_dx * dv_dx + du_dy * dv_dy;
+    double c = dv_dx * dv_dx + dv_dy * dv_dy;
+
+    double mean = 0.5 * (a + c);
+    double spread = sqrt(0.25 * (a - c) * (a - c) + b * b);
+    double major = sqrt(mean + spread);
+    double minor = sqrt(max(mean - spread, 0.0));
+    if (!(major > 1.0)) {
+        sampleMagnified<taps>(job, u, v, out);
+        return;
+    }
+
+    int last_level = job.mipmap->levelCount() - 1;
+    double lod = log2(max(minor, major / EWA_MAX_ANISOTROPY));
+    int level = lod < last_level ? (int) max(floor(lod), 0.0) : last_level;
+    const ImageView &texels = job.mipmap->level(level);
+    double scale = 1.0 / (1 << level);
+
+    // footprints too large even for the last level are shrunk so the loop below stays bounded
+    double shrink = scale * scale;
+    if (major * scale > EWA_MAX_ANISOTROPY)
+        shrink *= Sqr(EWA_MAX_ANISOTROPY / (major * scale));
+
+    // ellipse covariance in level texels plus the reconstruction radius, and its inverse
+    double a_level = a * shrink + 1.0;
+    double b_level = b * shrink;
+    double c_level = c * shrink + 1.0;
+    double det = a_level * c_level - b_level * b_level;
+    double A = c_level / det, B = -2.0 * b_level / det, C = a_level / det;
+
+    double center_u = (u + 0.5) * scale - 0.5;
+    double center_v = (v + 0.5) * scale - 0.5;
+    int u_begin = (int) ceil(center_u - sqrt(a_level)), u_end = (int) floor(center_u + sqrt(a_level));
+    int v_begin = (int) ceil(center_v - sqrt(c_level)), v_end = (int) floor(center_v + sqrt(c_level));
+
+    float rgba[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float weight_sum = 0.0f;
+    for (int tv = v_begin; tv <= v_end; tv++) {
+        double dv = tv - center_v;
+        int row = edgeIndex(tv, texels.height, job.edge);
+        for (int tu = u_begin; tu <= u_end; tu++) {
+            double du = tu - center_u;
+            double q = A * du * du + B * du * dv + C * dv * dv;
+            if (q >= 1.0)
+                continue;
+
+            // taps outside the image still count, they are transparent black
+            float w = EWA_WEIGHTS[(int) (q * EWA_WEIGHT_SAMPLES)];
+            weight_sum += w;
+            int col = edgeIndex(tu, texels.width, job.edge);
+            if (row < 0 or col < 0)
+                continue;
+
+            const pixel &p = *levelPixel(texels, col, row);
+            rgba[0] += w * p.r;
+            rgba[1] += w * p.g;
+            rgba[2] += w * p.b;
+            rgba[3] += w * p.a;
+        }
+    }
+
+    float normalize = weight_sum > 0.0f ? 1.0f / weight_sum : 0.0f;
+    out.r = rgba[0] * normalize;
+    out.g = rgba[1] * normalize;
+    out.b = rgba[2] * normalize;
+    out.a = rgba[3] * normalize;
+}
+
+
+template <int taps, MinifyMode minify, ImageLayout layout, typename T>
+static void warpMipmappedTile(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    pixel out;
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        const double x = tile.col_begin + job.origin[0];
+        const double y = row + job.origin[1];
+        double hx = m[0][0] * x + m[0][1] * y + m[0][2];
+        double hy = m[1][0] * x + m[1][1] * y + m[1][2];
+        double hw = m[2][0] * x + m[2][1] * y + m[2][2];
+
+        for (int col = tile.col_begin; col < tile.col_end; col++) {
+            // source position and the derivatives of u = hx / hw and v = hy / hw
+            double u = hx / hw, v = hy / hw;
+            double du_dx = (m[0][0] - u * m[2][0]) / hw, du_dy = (m[0][1] - u * m[2][1]) / hw;
+            double dv_dx = (m[1][0] - v * m[2][0]) / hw, dv_dy = (m[1][1] - v * m[2][1]) / hw;
+
+            // the horizon of a perspective maps to infinity
+            if (!isfinite(u) or !isfinite(v) or !isfinite(du_dx + du_dy + dv_dx + dv_dy))
+                memset(&out, 0, sizeof(pixel));
+            else if (minify == MINIFY_EWA)
+                sampleEwa<taps>(job, u, v, du_dx, dv_dx, du_dy, dv_dy, out);
+            else
+                sampleTrilinear<taps>(job, u, v, du_dx, dv_dx, du_dy, dv_dy, out);
+            Pixels<layout, T>::store(job.destination, col, row, out);
+
+            hx += m[0][0];
+            hy += m[1][0];
+            hw += m[2][0];
+        }
+    }
+}
+
+
+template <ImageLayout layout, typename T>
+static void warpMipmappedStorage(const WarpJob &job, const WarpTile &tile) {
+    bool ewa = job.minify == MINIFY_EWA;
+    switch (job.filter_table.taps) {
+        case 1:
+            ewa ? warpMipmappedTile<1, MINIFY_EWA, layout, T>(job, tile)
+                : warpMipmappedTile<1, MINIFY_TRILINEAR, layout, T>(job, tile);
+            break;
+        case 2:
+            ewa ? warpMipmappedTile<2, MINIFY_EWA, layout, T>(job, tile)
+                : warpMipmappedTile<2, MINIFY_TRILINEAR, layout, T>(job, tile);
+            break;
+        default:
+            ewa ? warpMipmappedTile<4, MINIFY_EWA, layout, T>(job, tile)
+                : warpMipmappedTile<4, MINIFY_TRILINEAR, layout, T>(job, tile);
+            break;
+    }
+}
+
+
+/*
+    Anti-aliased inverse map: the inverse Jacobian of every output pixel picks the mip level (trilinear)
+    or the filter ellipse (EWA) so minified regions are filtered at a cost per output pixel, magnified
+    regions use the job's reconstruction filter on level 0 of the pyramid
+ */
+void warpMipmapped(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.destination, warpMipmappedStorage, job, tile);
+}
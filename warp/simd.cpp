@@ -0,0 +1,393 @@
+#include "kernels.h"
+#include <algorithm>
+#include <climits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define WARP_SIMD_X86
+#endif
+
+using namespace std;
+
+
+/*
+    Tells whether the running CPU can execute kernels compiled for isa
+ */
+bool simdIsaSupported(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR:
+            return true;
+#ifdef WARP_SIMD_X86
+        case SIMD_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case SIMD_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+
+/*
+    Best instruction set supported by the running CPU
+ */
+SimdIsa detectSimdIsa() {
+    if (simdIsaSupported(SIMD_ISA_AVX512))
+        return SIMD_ISA_AVX512;
+    if (simdIsaSupported(SIMD_ISA_AVX2))
+        return SIMD_ISA_AVX2;
+    return SIMD_ISA_SCALAR;
+}
+
+
+/*
+    Parses an instruction set name given on the command line, "auto" picks the best supported one
+ */
+bool parseSimdIsa(const string &name, SimdIsa &isa) {
+    if (name == "auto")
+        isa = detectSimdIsa();
+    else if (name == "scalar")
+        isa = SIMD_ISA_SCALAR;
+    else if (name == "avx2")
+        isa = SIMD_ISA_AVX2;
+    else if (name == "avx512")
+        isa = SIMD_ISA_AVX512;
+    else
+        return false;
+    return true;
+}
+
+
+const char * simdIsaName(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_AVX2:
+            return "avx2";
+        case SIMD_ISA_AVX512:
+            return "avx512";
+        case SIMD_ISA_SCALAR:
+        default:
+            return "scalar";
+    }
+}
+
+
+/*
+    Copies the gathered source pixels of count output pixels starting at (col, row). Lanes whose bit
+    is clear in inside map outside the source and become transparent black.
+ */
+template <ImageLayout layout, typename T>
+static inline void storeLanes(const WarpJob &job, int col, int row, const int *iu, const int *iv,
+                              unsigned inside, int count) {
+    for (int i = 0; i < count; i++) {
+        if (inside & (1u << i))
+            Pixels<layout, T>::copyPixel(job.destination, col + i, row, job.source, iu[i], iv[i]);
+        else
+            Pixels<layout, T>::clear(job.destination, col + i, row, 1);
+    }
+}
+
+
+/*
+    Storage the vector kernels gather 32 bits at a time: one channel of a planar float image or a
+    whole interleaved or tiled 8 bit pixel. The element of source pixel (u, v) is at byte offset
+    v * row_stride + u * 4, or the block address of a tiled image, which has to fit in the 32 bit
+    offsets of the gather instructions.
+ */
+template <ImageLayout layout, typename T>
+static inline bool gathers32(const WarpJob &job) {
+    bool element = layout == LAYOUT_PLANAR ? sizeof(T) == 4 : sizeof(T) == 1;
+    long long rows = layout == LAYOUT_TILED ? (job.source.height + IMAGE_BLOCK_SIZE - 1) >> IMAGE_BLOCK_SHIFT
+                                            : job.source.height;
+    return element and job.source.row_stride > 0 and (long long) job.source.row_stride * rows <= INT_MAX;
+}
+
+
+/*
+    Source span of a row widened to whole vectors counted from the start of the tile, so only the last
+    vector of a tile can be partial, as without the span
+ */
+static inline WarpSpan vectorSpan(const SpanClipper &clipper, const WarpTile &tile, int row, int lanes) {
+    WarpSpan span = clipper.span(row);
+    span.begin = tile.col_begin + (span.begin - tile.col_begin) / lanes * lanes;
+    span.end = min(tile.col_end, span.begin + (span.end - span.begin + lanes - 1) / lanes * lanes);
+    return span;
+}
+
+
+#ifdef WARP_SIMD_X86
+
+/*
+    AVX2: the source coordinates of 8 output pixels are evaluated as two groups of 4 doubles with the
+    operation order of the reference kernel, narrowed to float, rounded half away from zero like
+    round() and bounds checked before the source pixels are gathered.
+ */
+__attribute__((target("avx2")))
+static inline __m128 sourceCoordinateAvx2(bool projective, __m256d x, __m256d m0, __m256d m1y, __m256d m2,
+                                          __m256d hw) {
+    __m256d h = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m0, x), m1y), m2);
+    if (!projective)
+        return _mm256_cvtpd_ps(h);
+    return _mm256_cvtpd_ps(_mm256_div_pd(_mm256_cvtps_pd(_mm256_cvtpd_ps(h)), hw));
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i roundHalfAwayAvx2(__m256 u) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 minus_half = _mm256_set1_ps(-0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 truncated = _mm256_round_ps(u, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 fraction = _mm256_sub_ps(u, truncated);
+    __m256 up = _mm256_and_ps(_mm256_cmp_ps(fraction, half, _CMP_GE_OQ), one);
+    __m256 down = _mm256_and_ps(_mm256_cmp_ps(fraction, minus_half, _CMP_LE_OQ), one);
+    return _mm256_cvttps_epi32(_mm256_sub_ps(_mm256_add_ps(truncated, up), down));
+}
+
+
+template <bool projective, ImageLayout layout, typename T>
+__attribute__((target("avx2")))
+static void warpTileAvx2(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    const __m256d m00 = _mm256_set1_pd(m[0][0]), m02 = _mm256_set1_pd(m[0][2]);
+    const __m256d m10 = _mm256_set1_pd(m[1][0]), m12 = _mm256_set1_pd(m[1][2]);
+    const __m256d m20 = _mm256_set1_pd(m[2][0]), m22 = _mm256_set1_pd(m[2][2]);
+    const __m256d origin_x = _mm256_set1_pd(job.origin[0]);
+    const __m128i lane_offsets = _mm_setr_epi32(0, 1, 2, 3);
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i width = _mm256_set1_epi32(job.source.width);
+    const __m256i height = _mm256_set1_epi32(job.source.height);
+    const __m256i row_stride = _mm256_set1_epi32((int) job.source.row_stride);
+    const bool gather = gathers32<layout, T>(job);
+    const SpanClipper clipper(job, tile, 0.0);
+    alignas(32) int iu[8], iv[8];
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        const double y = row + job.origin[1];
+        const __m256d m01y = _mm256_set1_pd(m[0][1] * y);
+        const __m256d m11y = _mm256_set1_pd(m[1][1] * y);
+        const __m256d m21y = _mm256_set1_pd(m[2][1] * y);
+
+        WarpSpan span = {tile.col_begin, tile.col_end};
+        if (clipper.clips()) {
+            span = vectorSpan(clipper, tile, row, 8);
+            Pixels<layout, T>::clear(job.destination, tile.col_begin, row, span.begin - tile.col_begin);
+            Pixels<layout, T>::clear(job.destination, span.end, row, tile.col_end - span.end);
+        }
+
+        for (int col = span.begin; col < span.end; col += 8) {
+            __m256d x_lo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_add_epi32(_mm_set1_epi32(col), lane_offsets)), origin_x);
+            __m256d x_hi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_add_epi32(_mm_set1_epi32(col + 4), lane_offsets)), origin_x);
+            __m256d hw_lo = m22, hw_hi = m22;
+            if (projective) {
+                hw_lo = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m20, x_lo), m21y), m22);
+                hw_hi = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m20, x_hi), m21y), m22);
+            }
+
+            __m256 u = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                    sourceCoordinateAvx2(projective, x_lo, m00, m01y, m02, hw_lo)),
+                    sourceCoordinateAvx2(projective, x_hi, m00, m01y, m02, hw_hi), 1);
+            __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                    sourceCoordinateAvx2(projective, x_lo, m10, m11y, m12, hw_lo)),
+                    sourceCoordinateAvx2(projective, x_hi, m10, m11y, m12, hw_hi), 1);
+
+            __m256i round_u = roundHalfAwayAvx2(u);
+            __m256i round_v = roundHalfAwayAvx2(v);
+            __m256i inside = _mm256_and_si256(
+                    _mm256_and_si256(_mm256_cmpgt_epi32(round_u, minus_one), _mm256_cmpgt_epi32(width, round_u)),
+                    _mm256_and_si256(_mm256_cmpgt_epi32(round_v, minus_one), _mm256_cmpgt_epi32(height, round_v)));
+
+            // every channel of 8 planar pixels, or 8 whole 8 bit pixels, is one masked gather and one
+            // contiguous store, the destination of a tiled source is interleaved
+            if (gather and span.end - col >= 8) {
+                __m256i offset;
+                if (layout == LAYOUT_TILED) {
+                    const __m256i mask = _mm256_set1_epi32(IMAGE_BLOCK_SIZE - 1);
+                    __m256i block = _mm256_slli_epi32(_mm256_srai_epi32(round_u, IMAGE_BLOCK_SHIFT), 2 * IMAGE_BLOCK_SHIFT);
+                    __m256i in_block = _mm256_add_epi32(
+                            _mm256_slli_epi32(_mm256_and_si256(round_v, mask), IMAGE_BLOCK_SHIFT),
+                            _mm256_and_si256(round_u, mask));
+                    offset = _mm256_add_epi32(
+                            _mm256_mullo_epi32(_mm256_srai_epi32(round_v, IMAGE_BLOCK_SHIFT), row_stride),
+                            _mm256_slli_epi32(_mm256_add_epi32(block, in_block), 2));
+                } else
+                    offset = _mm256_add_epi32(_mm256_mullo_epi32(round_v, row_stride), _mm256_slli_epi32(round_u, 2));
+                if (layout == LAYOUT_PLANAR)
+                    for (int channel = 0; channel < 4; channel++) {
+                        const float *plane = (const float *) (job.source.data + channel * job.source.plane_stride);
+                        __m256 values = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), plane, offset,
+                                                                 _mm256_castsi256_ps(inside), 1);
+                        _mm256_storeu_ps((float *) Pixels<LAYOUT_PLANAR, T>::at(job.destination, channel, col, row),
+                                         values);
+                    }
+                else {
+                    __m256i values = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *) job.source.data,
+                                                                 offset, inside, 1);
+                    _mm256_storeu_si256((__m256i *) Pixels<LAYOUT_INTERLEAVED, T>::at(job.destination, col, row),
+                                        values);
+                }
+                continue;
+            }
+
+            _mm256_store_si256((__m256i *) iu, round_u);
+            _mm256_store_si256((__m256i *) iv, round_v);
+            storeLanes<layout, T>(job, col, row, iu, iv, (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(inside)),
+                               min(8, span.end - col));
+        }
+    }
+}
+
+
+/*
+    AVX-512: same arithmetic as the AVX2 kernel on 16 output pixels, two groups of 8 doubles
+ */
+__attribute__((target("avx512f")))
+static inline __m256 sourceCoordinateAvx512(bool projective, __m512d x, __m512d m0, __m512d m1y, __m512d m2,
+                                            __m512d hw) {
+    __m512d h = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(m0, x), m1y), m2);
+    if (!projective)
+        return _mm512_cvtpd_ps(h);
+    return _mm512_cvtpd_ps(_mm512_div_pd(_mm512_cvtps_pd(_mm512_cvtpd_ps(h)), hw));
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512 combineAvx512(__m256 lo, __m256 hi) {
+    return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512i roundHalfAwayAvx512(__m512 u) {
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 minus_half = _mm512_set1_ps(-0.5f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    __m512 truncated = _mm512_roundscale_ps(u, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m512 fraction = _mm512_sub_ps(u, truncated);
+    __mmask16 up = _mm512_cmp_ps_mask(fraction, half, _CMP_GE_OQ);
+    __mmask16 down = _mm512_cmp_ps_mask(fraction, minus_half, _CMP_LE_OQ);
+    __m512 rounded = _mm512_mask_add_ps(truncated, up, truncated, one);
+    rounded = _mm512_mask_sub_ps(rounded, down, rounded, one);
+    return _mm512_cvttps_epi32(rounded);
+}
+
+
+template <bool projective, ImageLayout layout, typename T>
+__attribute__((target("avx512f")))
+static void warpTileAvx512(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    const __m512d m00 = _mm512_set1_pd(m[0][0]), m02 = _mm512_set1_pd(m[0][2]);
+    const __m512d m10 = _mm512_set1_pd(m[1][0]), m12 = _mm512_set1_pd(m[1][2]);
+    const __m512d m20 = _mm512_set1_pd(m[2][0]), m22 = _mm512_set1_pd(m[2][2]);
+    const __m512d origin_x = _mm512_set1_pd(job.origin[0]);
+    const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m512i minus_one = _mm512_set1_epi32(-1);
+    const __m512i width = _mm512_set1_epi32(job.source.width);
+    const __m512i height = _mm512_set1_epi32(job.source.height);
+    const __m512i row_stride = _mm512_set1_epi32((int) job.source.row_stride);
+    const bool gather = gathers32<layout, T>(job);
+    const SpanClipper clipper(job, tile, 0.0);
+    alignas(64) int iu[16], iv[16];
+
+    for (int row = tile.row_begin; row < tile.row_end; row++) {
+        const double y = row + job.origin[1];
+        const __m512d m01y = _mm512_set1_pd(m[0][1] * y);
+        const __m512d m11y = _mm512_set1_pd(m[1][1] * y);
+        const __m512d m21y = _mm512_set1_pd(m[2][1] * y);
+
+        WarpSpan span = {tile.col_begin, tile.col_end};
+        if (clipper.clips()) {
+            span = vectorSpan(clipper, tile, row, 16);
+            Pixels<layout, T>::clear(job.destination, tile.col_begin, row, span.begin - tile.col_begin);
+            Pixels<layout, T>::clear(job.destination, span.end, row, tile.col_end - span.end);
+        }
+
+        for (int col = span.begin; col < span.end; col += 16) {
+            __m512d x_lo = _mm512_add_pd(_mm512_cvtepi32_pd(_mm256_add_epi32(_mm256_set1_epi32(col), lane_offsets)), origin_x);
+            __m512d x_hi = _mm512_add_pd(_mm512_cvtepi32_pd(_mm256_add_epi32(_mm256_set1_epi32(col + 8), lane_offsets)), origin_x);
+            __m512d hw_lo = m22, hw_hi = m22;
+            if (projective) {
+                hw_lo = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(m20, x_lo), m21y), m22);
+                hw_hi = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(m20, x_hi), m21y), m22);
+            }
+
+            __m512 u = combineAvx512(sourceCoordinateAvx512(projective, x_lo, m00, m01y, m02, hw_lo),
+                                     sourceCoordinateAvx512(projective, x_hi, m00, m01y, m02, hw_hi));
+            __m512 v = combineAvx512(sourceCoordinateAvx512(projective, x_lo, m10, m11y, m12, hw_lo),
+                                     sourceCoordinateAvx512(projective, x_hi, m10, m11y, m12, hw_hi));
+
+            __m512i round_u = roundHalfAwayAvx512(u);
+            __m512i round_v = roundHalfAwayAvx512(v);
+            __mmask16 inside = _mm512_cmpgt_epi32_mask(round_u, minus_one) & _mm512_cmpgt_epi32_mask(width, round_u) &
+                               _mm512_cmpgt_epi32_mask(round_v, minus_one) & _mm512_cmpgt_epi32_mask(height, round_v);
+
+            if (gather and span.end - col >= 16) {
+                __m512i offset;
+                if (layout == LAYOUT_TILED) {
+                    const __m512i mask = _mm512_set1_epi32(IMAGE_BLOCK_SIZE - 1);
+                    __m512i block = _mm512_slli_epi32(_mm512_srai_epi32(round_u, IMAGE_BLOCK_SHIFT), 2 * IMAGE_BLOCK_SHIFT);
+                    __m512i in_block = _mm512_add_epi32(
+                            _mm512_slli_epi32(_mm512_and_si512(round_v, mask), IMAGE_BLOCK_SHIFT),
+                            _mm512_and_si512(round_u, mask));
+                    offset = _mm512_add_epi32(
+                            _mm512_mullo_epi32(_mm512_srai_epi32(round_v, IMAGE_BLOCK_SHIFT), row_stride),
+                            _mm512_slli_epi32(_mm512_add_epi32(block, in_block), 2));
+                } else
+                    offset = _mm512_add_epi32(_mm512_mullo_epi32(round_v, row_stride), _mm512_slli_epi32(round_u, 2));
+                if (layout == LAYOUT_PLANAR)
+                    for (int channel = 0; channel < 4; channel++) {
+                        const float *plane = (const float *) (job.source.data + channel * job.source.plane_stride);
+                        __m512 values = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), inside, offset, plane, 1);
+                        _mm512_storeu_ps((float *) Pixels<LAYOUT_PLANAR, T>::at(job.destination, channel, col, row),
+                                         values);
+                    }
+                else {
+                    __m512i values = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), inside, offset,
+                                                                 job.source.data, 1);
+                    _mm512_storeu_si512(Pixels<LAYOUT_INTERLEAVED, T>::at(job.destination, col, row), values);
+                }
+                continue;
+            }
+
+            _mm512_store_si512((void *) iu, round_u);
+            _mm512_store_si512((void *) iv, round_v);
+            storeLanes<layout, T>(job, col, row, iu, iv, (unsigned) inside, min(16, span.end - col));
+        }
+    }
+}
+
+#endif
+
+
+template <ImageLayout layout, typename T>
+static void warpSimdStorage(const WarpJob &job, const WarpTile &tile) {
+    const Matrix3x3 &m = job.inverse_matrix;
+    bool projective = m[2][0] != 0.0 or m[2][1] != 0.0 or m[2][2] != 1.0;
+
+    switch (job.isa) {
+#ifdef WARP_SIMD_X86
+        case SIMD_ISA_AVX512:
+            projective ? warpTileAvx512<true, layout, T>(job, tile) : warpTileAvx512<false, layout, T>(job, tile);
+            return;
+        case SIMD_ISA_AVX2:
+            projective ? warpTileAvx2<true, layout, T>(job, tile) : warpTileAvx2<false, layout, T>(job, tile);
+            return;
+#endif
+        default:
+            if (projective)
+                warpScanline(job, tile);
+            else
+                warpAffine(job, tile);
+    }
+}
+
+
+/*
+    Vectorized inverse map for affine and projective transforms, runs the kernel compiled for the
+    instruction set of the job and falls back to the scalar kernels when there is none
+ */
+void warpSimd(const WarpJob &job, const WarpTile &tile) {
+    DISPATCH_STORAGE(job.source, warpSimdStorage, job, tile);
+}
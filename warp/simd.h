@@ -0,0 +1,21 @@
+#ifndef _H_Simd
+#define _H_Simd
+
+#include <string>
+
+/*
+    Instruction sets the vectorized warp kernel is compiled for. The best one supported by the
+    running CPU is picked at startup, a specific one can be forced for testing.
+ */
+enum SimdIsa {
+    SIMD_ISA_SCALAR,  // no vector kernel, the scalar kernels are used
+    SIMD_ISA_AVX2,    // 8 output pixels per iteration
+    SIMD_ISA_AVX512   // 16 output pixels per iteration
+};
+
+SimdIsa detectSimdIsa();
+bool simdIsaSupported(SimdIsa isa);
+bool parseSimdIsa(const std::string &name, SimdIsa &isa);
+const char * simdIsaName(SimdIsa isa);
+
+#endif
@@ -0,0 +1,294 @@
+#include "sourcecache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+OIIO_NAMESPACE_USING
+
+
+/*
+    Copy of a rectangle of the source in the storage of the destination. view spans the whole source
+    with its data shifted so source coordinates inside the rectangle address the copy.
+ */
+struct SourceCache::Window {
+    vector<unsigned char> bytes;
+    ImageView view;
+};
+
+
+SourceCache::SourceCache(size_t memory_budget) : cache(NULL), memory_budget(memory_budget), source_width(0),
+                                                 source_height(0), source_x(0), source_y(0), source_z(0),
+                                                 source_channels(0), source_format(FORMAT_FLOAT), read_failed(false) {
+}
+
+
+SourceCache::~SourceCache() {
+    if (cache)
+        ImageCache::destroy(cache);
+}
+
+
+bool SourceCache::open(const string &name) {
+    cache = ImageCache::create(false);
+
+    // half of the budget caches file tiles, the other half is left for the windows of the threads
+    cache->attribute("max_memory_MB", (float) (memory_budget / 2) / (1024 * 1024));
+    cache->attribute("autotile", WARP_TILE_SIZE);
+
+    filename = ustring(name);
+    ImageSpec spec;
+    if (!cache->get_imagespec(filename, spec))
+        return false;
+
+    source_width = spec.width;
+    source_height = spec.height;
+    source_x = spec.x;
+    source_y = spec.y;
+    source_z = spec.z;
+    source_channels = spec.nchannels;
+    source_format = nativePixelFormat(spec.format);
+    return true;
+}
+
+
+string SourceCache::error() const {
+    return cache ? cache->geterror() : string();
+}
+
+
+int SourceCache::width() const {
+    return source_width;
+}
+
+
+int SourceCache::height() const {
+    return source_height;
+}
+
+
+int SourceCache::channels() const {
+    return source_channels;
+}
+
+
+PixelFormat SourceCache::format() const {
+    return source_format;
+}
+
+
+/*
+    Interleaves the bits of x and y, tiles sorted by the result form a Z shaped space filling curve
+ */
+static unsigned long long mortonKey(unsigned x, unsigned y) {
+    unsigned long long key = 0;
+    for (int bit = 0; bit < 32; bit++) {
+        key |= (unsigned long long) ((x >> bit) & 1) << (2 * bit);
+        key |= (unsigned long long) ((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return key;
+}
+
+
+bool SourceCache::warpTiledRows(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int row_begin,
+                                int row_end, int tile_size) {
+    vector<pair<unsigned long long, WarpTile> > tiles;
+
+    for (int row = row_begin; row < row_end; row += tile_size)
+        for (int col = 0; col < job.destination.width; col += tile_size) {
+            WarpTile tile;
+            tile.col_begin = col;
+            tile.col_end = min(col + tile_size, job.destination.width);
+            tile.row_begin = row;
+            tile.row_end = min(row + tile_size, row_end);
+            tiles.push_back(make_pair(mortonKey(col / tile_size, (row - row_begin) / tile_size), tile));
+        }
+    sort(tiles.begin(), tiles.end(),
+         [](const pair<unsigned long long, WarpTile> &a, const pair<unsigned long long, WarpTile> &b) {
+             return a.first < b.first;
+         });
+
+    // a window holds four samples of the destination's type per pixel
+    size_t pixel_bytes = 4 * pixelFormatSize(job.destination.format);
+    size_t max_pixels = max(memory_budget / 2 / pool.threadCount() / pixel_bytes, (size_t) tile_size * tile_size);
+    read_failed = false;
+    pool.run((int) tiles.size(), [&](int i) { warpTile(job, kernel, tiles[i].second, max_pixels); });
+    return !read_failed;
+}
+
+
+template <ImageLayout layout, typename T>
+static void clearPixel(const ImageView &image, int x, int y) {
+    Pixels<layout, T>::clear(image, x, y, 1);
+}
+
+
+/*
+    Fetches the source footprint of the tile and warps it. Tiles whose footprint is larger than
+    max_pixels or unbounded, because the horizon of a perspective crosses them, are split in halves
+    until it fits, a single output pixel only ever needs its filter taps.
+ */
+void SourceCache::warpTile(const WarpJob &job, WarpKernelFunction kernel, const WarpTile &tile,
+                           size_t max_pixels) {
+    static thread_local Window window;
+    const Matrix3x3 &m = job.inverse_matrix;
+
+    // the pixel centers lie inside the image of the tile's corners as long as hw keeps its sign,
+    // the margin covers the filter taps around the outermost samples
+    const int margin = job.filter_table.taps + 1;
+    double u_min = HUGE_VAL, u_max = -HUGE_VAL, v_min = HUGE_VAL, v_max = -HUGE_VAL;
+    int positive = 0;
+    bool bounded = true;
+    for (int corner = 0; corner < 4; corner++) {
+        double x = (corner & 1 ? tile.col_end - 1 : tile.col_begin) + job.origin[0];
+        double y = (corner & 2 ? tile.row_end - 1 : tile.row_begin) + job.origin[1];
+        double hw = m[2][0] * x + m[2][1] * y + m[2][2];
+        double u = (m[0][0] * x + m[0][1] * y + m[0][2]) / hw;
+        double v = (m[1][0] * x + m[1][1] * y + m[1][2]) / hw;
+        positive += hw > 0.0;
+        bounded = bounded and hw != 0.0 and isfinite(u) and isfinite(v);
+        u_min = min(u_min, u);
+        u_max = max(u_max, u);
+        v_min = min(v_min, v);
+        v_max = max(v_max, v);
+    }
+    bounded = bounded and (positive == 0 or positive == 4);
+
+    // clamped into the image, so clamped edge taps are always part of the window
+    int col_begin = 0, col_end = 0, row_begin = 0, row_end = 0;
+    if (bounded) {
+        col_begin = (int) max(min(floor(u_min) - margin, source_width - 1.0), 0.0);
+        col_end = (int) max(min(ceil(u_max) + margin + 1.0, (double) source_width), 1.0);
+        row_begin = (int) max(min(floor(v_min) - margin, source_height - 1.0), 0.0);
+        row_end = (int) max(min(ceil(v_max) + margin + 1.0, (double) source_height), 1.0);
+    }
+
+    size_t pixels = (size_t) (col_end - col_begin) * (row_end - row_begin);
+    bool single = tile.col_end - tile.col_begin == 1 and tile.row_end - tile.row_begin == 1;
+    if (!single and (!bounded or pixels > max_pixels)) {
+        WarpTile first = tile, second = tile;
+        if (tile.col_end - tile.col_begin >= tile.row_end - tile.row_begin)
+            first.col_end = second.col_begin = (tile.col_begin + tile.col_end) / 2;
+        else
+            first.row_end = second.row_begin = (tile.row_begin + tile.row_end) / 2;
+        warpTile(job, kernel, first, max_pixels);
+        warpTile(job, kernel, second, max_pixels);
+        return;
+    }
+
+    // a pixel exactly on the horizon has no source position
+    if (!bounded) {
+        DISPATCH_STORAGE(job.destination, clearPixel, job.destination, tile.col_begin, tile.row_begin);
+        return;
+    }
+
+    if (!fetch(window, job.destination.layout, job.destination.format, col_begin, col_end, row_begin, row_end))
+        read_failed = true;
+
+    WarpJob windowed = job;
+    windowed.source = window.view;
+    kernel(windowed, tile);
+}
+
+
+/*
+    Copies source columns col_begin .. col_end - 1 of rows row_begin .. row_end - 1 into the window.
+    The images are stored bottom up, so the rows come out of the file in reverse order. Planar
+    windows are read one channel at a time.
+ */
+bool SourceCache::fetch(Window &window, ImageLayout layout, PixelFormat format, int col_begin, int col_end,
+                        int row_begin, int row_end) {
+    const int size = pixelFormatSize(format);
+    const int pixel_bytes = layout == LAYOUT_PLANAR ? size : 4 * size;
+    size_t window_pixels = (size_t) (col_end - col_begin) * (row_end - row_begin);
+    window.bytes.resize(window_pixels * 4 * size);
+
+    // the rectangle itself, packed
+    ImageView rect;
+    rect.data = &window.bytes[0];
+    rect.width = col_end - col_begin;
+    rect.height = row_end - row_begin;
+    rect.layout = layout;
+    rect.format = format;
+    rect.row_stride = (ptrdiff_t) rect.width * pixel_bytes;
+    rect.plane_stride = layout == LAYOUT_PLANAR ? (ptrdiff_t) window_pixels * size : 0;
+
+    // in file coordinates, which start at the origin of the data window
+    int x_begin = source_x + col_begin, x_end = source_x + col_end;
+    int y_begin = source_y + source_height - row_end, y_end = source_y + source_height - row_begin;
+    int channels = min(source_channels, 4);
+    TypeDesc type = pixelFormatType(format);
+    ImageView top = rect.flipped();
+    bool read = true;
+    if (layout == LAYOUT_PLANAR)
+        for (int channel = 0; channel < channels and read; channel++)
+            read = cache->get_pixels(filename, 0, 0, x_begin, x_end, y_begin, y_end, source_z, source_z + 1,
+                                     channel, channel + 1, type, top.sample(channel, 0, 0), size, top.row_stride);
+    else
+        read = cache->get_pixels(filename, 0, 0, x_begin, x_end, y_begin, y_end, source_z, source_z + 1, 0,
+                                 channels, type, top.data, 4 * size, top.row_stride);
+    if (!read)
+        memset(&window.bytes[0], 0, window.bytes.size());
+    else if (source_channels == 3)
+        setOpaque(rect);
+
+    // addressed in source coordinates
+    window.view = rect.shifted(-row_begin);
+    window.view.data -= (ptrdiff_t) col_begin * pixel_bytes;
+    window.view.width = source_width;
+    window.view.height = source_height;
+    return read;
+}
+
+
+/*
+    Integer statistic of the cache, OIIO reports some of them as 64 bit and some as 32 bit
+ */
+long long SourceCache::statistic(const char *name) const {
+    long long value64 = 0;
+    if (cache->getattribute(name, TypeDesc::INT64, &value64))
+        return value64;
+    int value32 = 0;
+    if (cache->getattribute(name, TypeDesc::INT32, &value32))
+        return value32;
+    return 0;
+}
+
+
+double SourceCache::hitRate() const {
+    long long lookups = statistic("stat:find_tile_calls");
+    long long misses = statistic("stat:find_tile_cache_misses");
+    return lookups > 0 ? 1.0 - (double) misses / lookups : 1.0;
+}
+
+
+long long SourceCache::bytesRead() const {
+    return statistic("stat:bytes_read");
+}
+
+
+TypeDesc pixelFormatType(PixelFormat format) {
+    switch (format) {
+        case FORMAT_UINT8:
+            return TypeDesc::UINT8;
+        case FORMAT_UINT16:
+            return TypeDesc::UINT16;
+        case FORMAT_HALF:
+            return TypeDesc::HALF;
+        case FORMAT_FLOAT:
+        default:
+            return TypeDesc::FLOAT;
+    }
+}
+
+
+PixelFormat nativePixelFormat(TypeDesc type) {
+    if (type == TypeDesc::UINT8)
+        return FORMAT_UINT8;
+    if (type == TypeDesc::UINT16)
+        return FORMAT_UINT16;
+    if (type == TypeDesc::HALF)
+        return FORMAT_HALF;
+    return FORMAT_FLOAT;
+}
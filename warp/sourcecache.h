@@ -0,0 +1,67 @@
+#ifndef _H_SourceCache
+#define _H_SourceCache
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <OpenImageIO/imagecache.h>
+#include "kernels.h"
+
+/*
+    Source image that is never loaded as a whole. Pixels are read on demand through an OIIO
+    ImageCache holding at most part of the memory budget, scanline files are cached in 64x64 tiles.
+
+    Output tiles are warped in Morton order so neighbouring tiles, whose source footprints overlap,
+    run close together in time. Before a tile is warped the bounding box of its source footprint is
+    copied from the cache into a per thread window and the kernel reads the window through a view
+    addressed in source coordinates, so the kernels are the in-memory ones, unchanged.
+ */
+class SourceCache {
+public:
+    explicit SourceCache(size_t memory_budget);  // bytes shared by the cache and the windows
+    ~SourceCache();
+
+    bool open(const std::string &filename);
+    std::string error() const;
+
+    int width() const;
+    int height() const;
+    int channels() const;
+    PixelFormat format() const;  // native format of the file
+
+    // warps output rows row_begin .. row_end - 1, job.source is ignored
+    // returns false if reading the source failed, the affected pixels are transparent black
+    bool warpTiledRows(const WarpJob &job, WarpKernelFunction kernel, ThreadPool &pool, int row_begin,
+                       int row_end, int tile_size = WARP_TILE_SIZE);
+
+    double hitRate() const;       // fraction of tile lookups served from memory
+    long long bytesRead() const;  // bytes read from the file so far
+
+private:
+    struct Window;
+
+    void warpTile(const WarpJob &job, WarpKernelFunction kernel, const WarpTile &tile, size_t max_pixels);
+    bool fetch(Window &window, ImageLayout layout, PixelFormat format, int col_begin, int col_end, int row_begin,
+               int row_end);
+    long long statistic(const char *name) const;
+
+    OIIO::ImageCache *cache;
+    OIIO::ustring filename;
+    size_t memory_budget;
+    int source_width;
+    int source_height;
+    int source_x, source_y, source_z;  // origin of the data window, where get_pixels() starts
+    int source_channels;
+    PixelFormat source_format;
+    std::atomic<bool> read_failed;
+
+    SourceCache(const SourceCache &);
+    SourceCache &operator=(const SourceCache &);
+};
+
+// OIIO type of the samples of a pixel format
+OIIO::TypeDesc pixelFormatType(PixelFormat format);
+// smallest pixel format that holds the samples of a file without loss, float for anything unusual
+PixelFormat nativePixelFormat(OIIO::TypeDesc type);
+
+#endif
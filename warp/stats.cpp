@@ -0,0 +1,142 @@
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+
+atomic<bool> enabled(false);
+atomic<size_t> allocated(0);
+
+mutex stages_mutex;
+vector<StageStats> stages;
+
+}
+
+
+void enableStats(bool on) {
+    enabled.store(on, memory_order_relaxed);
+}
+
+
+bool statsEnabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+
+void countAllocation(size_t bytes) {
+    if (enabled.load(memory_order_relaxed))
+        allocated.fetch_add(bytes, memory_order_relaxed);
+}
+
+
+size_t peakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t) usage.ru_maxrss;         // bytes
+#else
+    return (size_t) usage.ru_maxrss * 1024;  // kilobytes
+#endif
+}
+
+
+vector<StageStats> stageStats() {
+    lock_guard<mutex> lock(stages_mutex);
+    return stages;
+}
+
+
+void printStats(FILE *file, StatsFormat format) {
+    vector<StageStats> totals = stageStats();
+    const double mb = 1024.0 * 1024.0;
+
+    if (format == STATS_JSON) {
+        fprintf(file, "{\n  \"peak_rss_bytes\": %zu,\n  \"stages\": [\n", peakResidentBytes());
+        for (size_t i = 0; i < totals.size(); i++) {
+            const StageStats &s = totals[i];
+            fprintf(file, "    {\"name\": \"%s\", \"calls\": %d, \"seconds\": %.6g, \"bytes_allocated\": %zu, "
+                          "\"peak_rss_bytes\": %zu}%s\n",
+                    s.name.c_str(), s.calls, s.seconds, s.bytes_allocated, s.peak_rss,
+                    i + 1 < totals.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+    }
+    else if (format == STATS_TEXT) {
+        fprintf(file, "\n%-12s %6s %12s %14s %12s\n", "stage", "calls", "seconds", "allocated MB", "peak RSS MB");
+        for (size_t i = 0; i < totals.size(); i++) {
+            const StageStats &s = totals[i];
+            fprintf(file, "%-12s %6d %12.6f %14.1f %12.1f\n", s.name.c_str(), s.calls, s.seconds,
+                    s.bytes_allocated / mb, s.peak_rss / mb);
+        }
+        fprintf(file, "Peak RSS: %.1f MB\n", peakResidentBytes() / mb);
+    }
+}
+
+
+bool parseStatsFormat(const string &name, StatsFormat &format) {
+    if (name == "off")
+        format = STATS_OFF;
+    else if (name == "text")
+        format = STATS_TEXT;
+    else if (name == "json")
+        format = STATS_JSON;
+    else
+        return false;
+    return true;
+}
+
+
+const char * statsFormatName(StatsFormat format) {
+    switch (format) {
+        case STATS_OFF:
+            return "off";
+        case STATS_TEXT:
+            return "text";
+        case STATS_JSON:
+            return "json";
+    }
+    return "unknown";
+}
+
+
+ScopedStage::ScopedStage(const char *name) : name(NULL), allocated_at_start(0) {
+    if (!enabled.load(memory_order_relaxed))
+        return;
+    this->name = name;
+    allocated_at_start = allocated.load(memory_order_relaxed);
+    start = chrono::steady_clock::now();
+}
+
+
+ScopedStage::~ScopedStage() {
+    if (!name)
+        return;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t bytes = allocated.load(memory_order_relaxed) - allocated_at_start;
+    size_t peak_rss = peakResidentBytes();
+
+    lock_guard<mutex> lock(stages_mutex);
+    size_t i = 0;
+    while (i < stages.size() and stages[i].name != name)
+        i++;
+    if (i == stages.size()) {
+        StageStats stage;
+        stage.name = name;
+        stage.calls = 0;
+        stage.seconds = 0.0;
+        stage.bytes_allocated = 0;
+        stage.peak_rss = 0;
+        stages.push_back(stage);
+    }
+    StageStats &stage = stages[i];
+    stage.calls++;
+    stage.seconds += seconds;
+    stage.bytes_allocated += bytes;
+    stage.peak_rss = max(stage.peak_rss, peak_rss);
+}
+
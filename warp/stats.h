@@ -0,0 +1,63 @@
+#ifndef _H_Stats
+#define _H_Stats
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+    Time and memory of the stages of a run: reading the source, parsing the transform, sizing the
+    output, the warp and writing it. A ScopedStage measures the wall time of its scope, the bytes
+    allocated meanwhile and the peak resident set size at its end, and adds them to the totals of
+    its stage name.
+
+    Everything is off until enableStats() is called, until then a ScopedStage and every allocation
+    cost no more than the test of a flag. Bytes allocated are counted process wide, through operator
+    new in programs that link operatornew.cpp and countAllocation() for buffers from malloc and
+    friends, so stages running at the same time on different threads, like those of a pipelined
+    batch, share what either allocates.
+ */
+enum StatsFormat {
+    STATS_OFF,
+    STATS_TEXT,
+    STATS_JSON
+};
+
+struct StageStats {
+    std::string name;
+    int calls;
+    double seconds;
+    size_t bytes_allocated;
+    size_t peak_rss;          // bytes, largest at the end of any call
+};
+
+void enableStats(bool enabled);
+bool statsEnabled();
+
+// counts an allocation that does not go through operator new
+void countAllocation(size_t bytes);
+
+size_t peakResidentBytes();                  // 0 where the system does not tell
+std::vector<StageStats> stageStats();        // in the order the stages first ended
+void printStats(FILE *file, StatsFormat format);
+
+bool parseStatsFormat(const std::string &name, StatsFormat &format);
+const char * statsFormatName(StatsFormat format);
+
+class ScopedStage {
+public:
+    explicit ScopedStage(const char *name);  // name has to outlive the scope
+    ~ScopedStage();
+
+private:
+    const char *name;                        // NULL when stats are off
+    std::chrono::steady_clock::time_point start;
+    size_t allocated_at_start;
+
+    ScopedStage(const ScopedStage &);
+    ScopedStage &operator=(const ScopedStage &);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "threadpool.h"
+
+using namespace std;
+
+
+ThreadPool::ThreadPool(int thread_count) : current_task(NULL), remaining(0), generation(0),
+                                           busy_workers(0), stopping(false) {
+    if (thread_count <= 0)
+        thread_count = (int) thread::hardware_concurrency();
+    if (thread_count <= 0)
+        thread_count = 1;
+
+    for (int i = 0; i < thread_count; i++)
+        queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+
+    // worker 0 is the thread calling run()
+    for (int i = 1; i < thread_count; i++)
+        threads.push_back(thread(&ThreadPool::workerLoop, this, i));
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+
+int ThreadPool::threadCount() const {
+    return (int) queues.size();
+}
+
+
+/*
+    Deals the task indices out in contiguous blocks, one block per worker, so neighbouring tiles
+    start on the same thread. Stealing evens out blocks that turn out to be cheap or expensive.
+ */
+void ThreadPool::run(int task_count, const function<void(int)> &task) {
+    if (task_count <= 0)
+        return;
+    lock_guard<std::mutex> run_lock(run_mutex);
+
+    // a worker still waking up from the previous run may pick tasks up as soon as they are queued,
+    // so the task has to be published first
+    {
+        lock_guard<std::mutex> lock(mutex);
+        current_task = &task;
+        remaining = task_count;
+        generation++;
+
+        int workers = threadCount();
+        for (int w = 0; w < workers; w++) {
+            int begin = (int) ((long long) task_count * w / workers);
+            int end = (int) ((long long) task_count * (w + 1) / workers);
+            lock_guard<std::mutex> queue_lock(queues[w]->mutex);
+            for (int i = begin; i < end; i++)
+                queues[w]->tasks.push_back(i);
+        }
+    }
+    wake.notify_all();
+
+    work(0);
+
+    unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return remaining == 0 and busy_workers == 0; });
+    current_task = NULL;
+}
+
+
+void ThreadPool::workerLoop(int worker) {
+    int seen_generation = 0;
+    unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [&] { return stopping or generation != seen_generation; });
+        if (stopping)
+            return;
+
+        seen_generation = generation;
+        busy_workers++;
+        lock.unlock();
+
+        work(worker);
+
+        lock.lock();
+        busy_workers--;
+        if (busy_workers == 0 and remaining == 0)
+            finished.notify_all();
+    }
+}
+
+
+void ThreadPool::work(int worker) {
+    int task;
+    while (popTask(worker, task)) {
+        (*current_task)(task);
+        if (--remaining == 0) {
+            lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+
+/*
+    Takes the next task from the front of the worker's own deque, or steals the back task of
+    another worker's deque when its own is empty. Returns false when no work is left anywhere.
+ */
+bool ThreadPool::popTask(int worker, int &task) {
+    {
+        WorkQueue &own = *queues[worker];
+        lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    int workers = threadCount();
+    for (int i = 1; i < workers; i++) {
+        WorkQueue &victim = *queues[(worker + i) % workers];
+        lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
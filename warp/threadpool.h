@@ -0,0 +1,56 @@
+#ifndef _H_ThreadPool
+#define _H_ThreadPool
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Fixed set of worker threads running indexed tasks with work stealing. Every worker owns a deque
+    of task indices, works through it front to back and, once it is empty, steals from the back of
+    the other workers' deques. The thread calling run() works as worker 0.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int thread_count = 0);  // 0 = std::thread::hardware_concurrency()
+    ~ThreadPool();
+
+    int threadCount() const;
+
+    // runs task(0) .. task(task_count - 1) and returns when all of them have finished,
+    // runs from several threads take turns
+    void run(int task_count, const std::function<void(int)> &task);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void workerLoop(int worker);
+    void work(int worker);
+    bool popTask(int worker, int &task);
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+
+    std::mutex run_mutex;  // held for a whole run
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int)> *current_task;
+    std::atomic<int> remaining;
+    int generation;
+    int busy_workers;
+    bool stopping;
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+};
+
+#endif